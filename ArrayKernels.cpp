@@ -0,0 +1,225 @@
+#include "ArrayKernels.hpp"
+#include "Simd.hpp"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SYNZE_X86_64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#define SYNZE_TARGET_AVX2
+#else
+#define SYNZE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// Each operation has a scalar form and, on x86-64, a four-lane form.
+struct Add {
+    static double apply(double a, double b) { return a + b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_add_pd(a, b); }
+#endif
+};
+
+struct Subtract {
+    static double apply(double a, double b) { return a - b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_sub_pd(a, b); }
+#endif
+};
+
+struct Multiply {
+    static double apply(double a, double b) { return a * b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_mul_pd(a, b); }
+#endif
+};
+
+struct Divide {
+    static double apply(double a, double b) { return a / b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_div_pd(a, b); }
+#endif
+};
+
+// Matches _mm256_min_pd / _mm256_max_pd, including which operand wins for NaN.
+struct Min {
+    static double apply(double a, double b) { return a < b ? a : b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_min_pd(a, b); }
+#endif
+};
+
+struct Max {
+    static double apply(double a, double b) { return a > b ? a : b; }
+#ifdef SYNZE_X86_64
+    SYNZE_TARGET_AVX2 static __m256d apply(__m256d a, __m256d b) { return _mm256_max_pd(a, b); }
+#endif
+};
+
+bool useAvx2() {
+    return getSimdLevel() == SimdLevel::AVX2;
+}
+
+template <typename Op>
+void elementwiseScalar(const double* left, bool leftScalar, const double* right, bool rightScalar, double* out, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        out[i] = Op::apply(left[leftScalar ? 0 : i], right[rightScalar ? 0 : i]);
+    }
+}
+
+// Lanes combine as (0 + 1) + (2 + 3); the tail is then folded in order.
+template <typename Op>
+double combineLanes(const double* lanes, const double* tail, size_t count) {
+    double result = Op::apply(Op::apply(lanes[0], lanes[1]), Op::apply(lanes[2], lanes[3]));
+    for (size_t i = 0; i < count; ++i) {
+        result = Op::apply(result, tail[i]);
+    }
+    return result;
+}
+
+// Reductions over four lanes starting from `initial`, or from the first four
+// elements when there is no identity value (min, max).
+template <typename Op>
+double reduceScalar(const double* data, size_t size, const double* initial) {
+    double lanes[4];
+    size_t i = 0;
+    if (size < 4 && !initial) {
+        double result = data[0];
+        for (i = 1; i < size; ++i) {
+            result = Op::apply(result, data[i]);
+        }
+        return result;
+    }
+    for (int k = 0; k < 4; ++k) {
+        lanes[k] = initial ? *initial : data[k];
+    }
+    if (!initial) i = 4;
+    for (; i + 4 <= size; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            lanes[k] = Op::apply(lanes[k], data[i + k]);
+        }
+    }
+    return combineLanes<Op>(lanes, data + i, size - i);
+}
+
+double dotScalar(const double* left, const double* right, size_t size) {
+    double lanes[4] = { 0, 0, 0, 0 };
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        for (int k = 0; k < 4; ++k) {
+            lanes[k] += left[i + k] * right[i + k];
+        }
+    }
+    double result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < size; ++i) {
+        result += left[i] * right[i];
+    }
+    return result;
+}
+
+#ifdef SYNZE_X86_64
+template <typename Op>
+SYNZE_TARGET_AVX2 void elementwiseAvx2(const double* left, bool leftScalar, const double* right, bool rightScalar, double* out,
+                                       size_t size) {
+    // Only a scalar side is read up front; an empty array has no element 0.
+    __m256d leftBroadcast = leftScalar ? _mm256_set1_pd(left[0]) : _mm256_setzero_pd();
+    __m256d rightBroadcast = rightScalar ? _mm256_set1_pd(right[0]) : _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        __m256d a = leftScalar ? leftBroadcast : _mm256_loadu_pd(left + i);
+        __m256d b = rightScalar ? rightBroadcast : _mm256_loadu_pd(right + i);
+        _mm256_storeu_pd(out + i, Op::apply(a, b));
+    }
+    for (; i < size; ++i) {
+        out[i] = Op::apply(left[leftScalar ? 0 : i], right[rightScalar ? 0 : i]);
+    }
+}
+
+template <typename Op>
+SYNZE_TARGET_AVX2 double reduceAvx2(const double* data, size_t size, const double* initial) {
+    if (size < 4 && !initial) return reduceScalar<Op>(data, size, initial);
+    __m256d accumulator = initial ? _mm256_set1_pd(*initial) : _mm256_loadu_pd(data);
+    size_t i = initial ? 0 : 4;
+    for (; i + 4 <= size; i += 4) {
+        accumulator = Op::apply(accumulator, _mm256_loadu_pd(data + i));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, accumulator);
+    return combineLanes<Op>(lanes, data + i, size - i);
+}
+
+// Multiply then add, never fused, to round exactly like dotScalar.
+SYNZE_TARGET_AVX2 double dotAvx2(const double* left, const double* right, size_t size) {
+    __m256d accumulator = _mm256_setzero_pd();
+    size_t i = 0;
+    for (; i + 4 <= size; i += 4) {
+        accumulator = _mm256_add_pd(accumulator, _mm256_mul_pd(_mm256_loadu_pd(left + i), _mm256_loadu_pd(right + i)));
+    }
+    double lanes[4];
+    _mm256_storeu_pd(lanes, accumulator);
+    double result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    for (; i < size; ++i) {
+        result += left[i] * right[i];
+    }
+    return result;
+}
+#endif
+
+template <typename Op>
+void elementwise(const double* left, bool leftScalar, const double* right, bool rightScalar, double* out, size_t size) {
+#ifdef SYNZE_X86_64
+    if (useAvx2()) {
+        elementwiseAvx2<Op>(left, leftScalar, right, rightScalar, out, size);
+        return;
+    }
+#endif
+    elementwiseScalar<Op>(left, leftScalar, right, rightScalar, out, size);
+}
+
+template <typename Op>
+double reduce(const double* data, size_t size, const double* initial) {
+#ifdef SYNZE_X86_64
+    if (useAvx2()) return reduceAvx2<Op>(data, size, initial);
+#endif
+    return reduceScalar<Op>(data, size, initial);
+}
+
+}
+
+void arrayArithmetic(char op, const double* left, bool leftScalar, const double* right, bool rightScalar, double* out,
+                     size_t size) {
+    switch (op) {
+        case '+': elementwise<Add>(left, leftScalar, right, rightScalar, out, size); break;
+        case '-': elementwise<Subtract>(left, leftScalar, right, rightScalar, out, size); break;
+        case '*': elementwise<Multiply>(left, leftScalar, right, rightScalar, out, size); break;
+        case '/': elementwise<Divide>(left, leftScalar, right, rightScalar, out, size); break;
+        default:
+            // No vector pow; std::pow per element either way.
+            for (size_t i = 0; i < size; ++i) {
+                out[i] = std::pow(left[leftScalar ? 0 : i], right[rightScalar ? 0 : i]);
+            }
+            break;
+    }
+}
+
+double arraySum(const double* data, size_t size) {
+    const double zero = 0;
+    return reduce<Add>(data, size, &zero);
+}
+
+double arrayDot(const double* left, const double* right, size_t size) {
+#ifdef SYNZE_X86_64
+    if (useAvx2()) return dotAvx2(left, right, size);
+#endif
+    return dotScalar(left, right, size);
+}
+
+double arrayMin(const double* data, size_t size) {
+    return reduce<Min>(data, size, nullptr);
+}
+
+double arrayMax(const double* data, size_t size) {
+    return reduce<Max>(data, size, nullptr);
+}
@@ -0,0 +1,21 @@
+#ifndef ARRAYKERNELS_HPP
+#define ARRAYKERNELS_HPP
+
+#include <cstddef>
+
+// Loops over double arrays, with an AVX2 version used when the active SIMD
+// level (see Simd.hpp) allows it. Reductions accumulate in four lanes in both
+// versions, so results are identical whichever one runs.
+
+// out[i] = left[i] op right[i] for op in "+-*/^". A side marked scalar is a
+// single value combined with every element of the other side.
+void arrayArithmetic(char op, const double* left, bool leftScalar, const double* right, bool rightScalar, double* out,
+                     size_t size);
+
+double arraySum(const double* data, size_t size);
+double arrayDot(const double* left, const double* right, size_t size);
+// Both require size > 0.
+double arrayMin(const double* data, size_t size);
+double arrayMax(const double* data, size_t size);
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef AST_HPP
+#define AST_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Value.hpp"
+
+// Where a name lives at run time, filled in by the Resolver: a local slot of
+// the enclosing function, or a global slot (the name's symbol id).
+struct Slot {
+    bool local = false;
+    uint32_t index = 0;
+};
+
+struct Expr {
+    enum class Kind { Literal, Template, Variable, Input, Binary, Compare, Array, Index, Builtin };
+
+    Expr(Kind kind, int line) : kind(kind), line(line) {}
+    virtual ~Expr() = default;
+
+    Kind kind;
+    int line;
+};
+
+using ExprPtr = std::unique_ptr<Expr>;
+
+struct LiteralExpr : Expr {
+    LiteralExpr(int line, Value value) : Expr(Kind::Literal, line), value(std::move(value)) {}
+
+    Value value;
+};
+
+// A string literal containing {name} placeholders, split into its pieces.
+struct TemplatePart {
+    bool isVariable;
+    std::string text;
+    Slot slot;
+};
+
+struct TemplateExpr : Expr {
+    explicit TemplateExpr(int line) : Expr(Kind::Template, line) {}
+
+    std::vector<TemplatePart> parts;
+};
+
+struct VariableExpr : Expr {
+    VariableExpr(int line, std::string name) : Expr(Kind::Variable, line), name(std::move(name)) {}
+
+    std::string name;
+    Slot slot;
+};
+
+// `input` reads a line from stdin. With a target (`send input name`) the line is
+// stored in that variable as a string and the expression itself yields "".
+struct InputExpr : Expr {
+    InputExpr(int line, std::string target) : Expr(Kind::Input, line), target(std::move(target)) {}
+
+    std::string target;
+    Slot slot;
+};
+
+struct BinaryExpr : Expr {
+    BinaryExpr(int line, char op, ExprPtr left, ExprPtr right)
+        : Expr(Kind::Binary, line), op(op), left(std::move(left)), right(std::move(right)) {}
+
+    char op;
+    ExprPtr left;
+    ExprPtr right;
+};
+
+enum class CompareOp { Equal, NotEqual, Less, Greater, LessEqual, GreaterEqual };
+
+struct CompareExpr : Expr {
+    CompareExpr(int line, CompareOp op, ExprPtr left, ExprPtr right)
+        : Expr(Kind::Compare, line), op(op), left(std::move(left)), right(std::move(right)) {}
+
+    CompareOp op;
+    ExprPtr left;
+    ExprPtr right;
+};
+
+// `[a, b, c]`: every element must evaluate to a number.
+struct ArrayExpr : Expr {
+    explicit ArrayExpr(int line) : Expr(Kind::Array, line) {}
+
+    std::vector<ExprPtr> elements;
+};
+
+// `array[index]`, counting from 0.
+struct IndexExpr : Expr {
+    IndexExpr(int line, ExprPtr target, ExprPtr index)
+        : Expr(Kind::Index, line), target(std::move(target)), index(std::move(index)) {}
+
+    ExprPtr target;
+    ExprPtr index;
+};
+
+enum class Builtin { Len, Sum, Min, Max, Dot };
+
+inline const char* builtinName(Builtin builtin) {
+    static const char* const names[] = { "len", "sum", "min", "max", "dot" };
+    return names[static_cast<int>(builtin)];
+}
+
+inline size_t builtinArity(Builtin builtin) {
+    return builtin == Builtin::Dot ? 2 : 1;
+}
+
+// A call to a built-in function such as `len(values)`; the parser checks the
+// argument count.
+struct BuiltinExpr : Expr {
+    BuiltinExpr(int line, Builtin builtin) : Expr(Kind::Builtin, line), builtin(builtin) {}
+
+    Builtin builtin;
+    std::vector<ExprPtr> args;
+};
+
+struct Stmt {
+    enum class Kind { Send, Assign, Call, FuncDef, If, Run, Exit, While, For, Import };
+
+    Stmt(Kind kind, int line) : kind(kind), line(line) {}
+    virtual ~Stmt() = default;
+
+    Kind kind;
+    int line;
+};
+
+using StmtPtr = std::unique_ptr<Stmt>;
+using Block = std::vector<StmtPtr>;
+
+struct SendStmt : Stmt {
+    SendStmt(int line, ExprPtr value) : Stmt(Kind::Send, line), value(std::move(value)) {}
+
+    ExprPtr value;
+};
+
+// `declaration` is set for `variable name = ...`, which makes `name` a local
+// when it appears inside a function.
+struct AssignStmt : Stmt {
+    AssignStmt(int line, std::string name, ExprPtr value, bool declaration)
+        : Stmt(Kind::Assign, line), name(std::move(name)), value(std::move(value)), declaration(declaration) {}
+
+    std::string name;
+    ExprPtr value;
+    bool declaration;
+    Slot slot;
+};
+
+struct CallStmt : Stmt {
+    CallStmt(int line, std::string name) : Stmt(Kind::Call, line), name(std::move(name)) {}
+
+    std::string name;
+    std::vector<ExprPtr> args;
+    Slot callee;
+};
+
+struct FunctionDef {
+    std::string name;
+    std::vector<std::string> params;
+    // Parameters first, then every name declared with `variable` in the body.
+    // Each call gets one slot per local; all other names refer to globals.
+    std::vector<std::string> locals;
+    Block body;
+    // Where the function was defined, set by the Resolver. REPL code has no file.
+    std::string file;
+    int line = 0;
+    // Written `pure func`: loading fails unless the function can be memoized,
+    // and it may read globals, listed in `inputs` once marked.
+    bool declaredPure = false;
+    // Set by markPureFunctions(): every call with the same arguments has the
+    // same effect, assigning the globals in `outputs`, so calls can be cached.
+    bool pure = false;
+    std::vector<uint32_t> outputs;
+    // Globals a pure function reads before assigning them. Their values are
+    // part of the cache key, along with the arguments.
+    std::vector<uint32_t> inputs;
+};
+
+struct FuncDefStmt : Stmt {
+    FuncDefStmt(int line, std::shared_ptr<FunctionDef> function)
+        : Stmt(Kind::FuncDef, line), function(std::move(function)) {}
+
+    std::shared_ptr<FunctionDef> function;
+    Slot slot;
+};
+
+struct IfBranch {
+    ExprPtr condition;
+    Block body;
+};
+
+// An if / else if / else chain. A missing else leaves elseBody empty.
+struct IfStmt : Stmt {
+    explicit IfStmt(int line) : Stmt(Kind::If, line) {}
+
+    std::vector<IfBranch> branches;
+    Block elseBody;
+};
+
+struct WhileStmt : Stmt {
+    WhileStmt(int line, ExprPtr condition) : Stmt(Kind::While, line), condition(std::move(condition)) {}
+
+    ExprPtr condition;
+    Block body;
+};
+
+// `for name in start..end` counts from start up to, but not including, end.
+// Both bounds are evaluated once; the body sees each value in `name`, which is
+// a local when the loop is inside a function.
+struct ForStmt : Stmt {
+    ForStmt(int line, std::string name, ExprPtr start, ExprPtr end)
+        : Stmt(Kind::For, line), name(std::move(name)), start(std::move(start)), end(std::move(end)) {}
+
+    std::string name;
+    ExprPtr start;
+    ExprPtr end;
+    Block body;
+    Slot slot;
+};
+
+struct RunStmt : Stmt {
+    RunStmt(int line, std::string path) : Stmt(Kind::Run, line), path(std::move(path)) {}
+
+    std::string path;
+};
+
+// `import path [as name]` runs a module once and puts its top-level names
+// under `name.`, which defaults to the file name without its extension.
+struct ImportStmt : Stmt {
+    ImportStmt(int line, std::string path, std::string name)
+        : Stmt(Kind::Import, line), path(std::move(path)), name(std::move(name)) {}
+
+    std::string path;
+    std::string name;
+};
+
+struct ExitStmt : Stmt {
+    explicit ExitStmt(int line) : Stmt(Kind::Exit, line) {}
+};
+
+struct Program {
+    Block statements;
+};
+
+#endif
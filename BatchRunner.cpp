@@ -0,0 +1,108 @@
+#include "BatchRunner.hpp"
+#include "WorkStealingPool.hpp"
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+std::vector<BatchResult> BatchRunner::run(const std::vector<std::string>& scripts,
+                                          const std::function<void(const BatchResult&)>& emit) {
+    std::vector<BatchResult> results(scripts.size());
+    std::vector<char> finished(scripts.size(), 0);
+    size_t nextToEmit = 0;
+    std::mutex emitMutex;
+
+    WorkStealingPool(jobs).run(scripts.size(), [&](size_t index) {
+        results[index] = runScript(scripts[index]);
+
+        std::lock_guard<std::mutex> lock(emitMutex);
+        finished[index] = 1;
+        while (nextToEmit < results.size() && finished[nextToEmit]) {
+            if (emit) emit(results[nextToEmit]);
+            ++nextToEmit;
+        }
+    });
+    return results;
+}
+
+BatchResult BatchRunner::runScript(const std::string& path) const {
+    BatchResult result;
+    result.path = path;
+
+    StringSink output;
+    StringSink errors;
+    output.setFlushPolicy(OutputSink::FlushPolicy::Exit);
+    errors.setFlushPolicy(OutputSink::FlushPolicy::Exit);
+    std::istringstream noInput;
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        Interpreter interpreter;
+        // The batch summary reports timings; output stays the same from run to run.
+        interpreter.setRunSummaries(false);
+        if (configure) configure(interpreter);
+        interpreter.setOutputSink(output);
+        interpreter.setErrorSink(errors);
+        interpreter.setInputStream(noInput);
+
+        interpreter.handleRunCommand(path);
+        result.errorCount = interpreter.getErrorCount();
+        result.status = result.errorCount == 0 ? BatchResult::Status::Ok : BatchResult::Status::Errors;
+    } catch (const std::exception& e) {
+        errors.write(std::string("Error: ") + e.what());
+        errors.endLine();
+        result.status = BatchResult::Status::Failed;
+    }
+    result.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    result.output = output.str();
+    result.errors = errors.str();
+    return result;
+}
+
+std::vector<std::string> BatchRunner::readManifest(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open manifest: " + path);
+    }
+
+    std::vector<std::string> scripts;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') continue;
+        size_t last = line.find_last_not_of(" \t\r");
+        scripts.push_back(line.substr(first, last - first + 1));
+    }
+    return scripts;
+}
+
+void BatchRunner::printSummary(std::ostream& out, const std::vector<BatchResult>& results, unsigned jobs, double milliseconds) {
+    size_t ok = 0;
+    size_t withErrors = 0;
+    size_t failed = 0;
+    for (const BatchResult& result : results) {
+        switch (result.status) {
+            case BatchResult::Status::Ok: ++ok; break;
+            case BatchResult::Status::Errors: ++withErrors; break;
+            case BatchResult::Status::Failed: ++failed; break;
+        }
+    }
+
+    out << "\nRan " << results.size() << " scripts on " << jobs << " threads in " << std::fixed << std::setprecision(1)
+        << milliseconds << " ms: " << ok << " ok, " << withErrors << " with errors, " << failed << " failed\n";
+    for (const BatchResult& result : results) {
+        out << std::setw(10) << result.milliseconds << " ms  ";
+        switch (result.status) {
+            case BatchResult::Status::Ok: out << "ok      "; break;
+            case BatchResult::Status::Errors: out << "errors  "; break;
+            case BatchResult::Status::Failed: out << "failed  "; break;
+        }
+        out << result.path;
+        if (result.status == BatchResult::Status::Errors) out << " (" << result.errorCount << ")";
+        out << '\n';
+    }
+    out << std::defaultfloat << std::flush;
+}
@@ -0,0 +1,47 @@
+#ifndef BATCHRUNNER_HPP
+#define BATCHRUNNER_HPP
+
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Interpreter.hpp"
+
+struct BatchResult {
+    // Errors: the script ran but reported errors. Failed: it could not be run.
+    enum class Status { Ok, Errors, Failed };
+
+    std::string path;
+    std::string output;
+    std::string errors;
+    Status status = Status::Ok;
+    size_t errorCount = 0;
+    double milliseconds = 0;
+};
+
+// Runs many scripts in parallel, each in a fresh Interpreter with its own
+// captured output and no standard input.
+class BatchRunner {
+public:
+    explicit BatchRunner(unsigned jobs) : jobs(jobs) {}
+
+    // Applied to every interpreter before its script runs.
+    void setConfigure(std::function<void(Interpreter&)> configure) { this->configure = std::move(configure); }
+
+    // `emit` sees the results in script order, each as soon as it and all
+    // scripts before it have finished. Calls to `emit` never overlap.
+    std::vector<BatchResult> run(const std::vector<std::string>& scripts,
+                                 const std::function<void(const BatchResult&)>& emit);
+
+    // One script path per line; blank lines and lines starting with '#' are skipped.
+    static std::vector<std::string> readManifest(const std::string& path);
+    static void printSummary(std::ostream& out, const std::vector<BatchResult>& results, unsigned jobs, double milliseconds);
+
+private:
+    unsigned jobs;
+    std::function<void(Interpreter&)> configure;
+
+    BatchResult runScript(const std::string& path) const;
+};
+
+#endif
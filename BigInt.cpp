@@ -0,0 +1,259 @@
+#include "BigInt.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+
+bool checkedPower(int64_t base, int64_t exponent, int64_t& result) {
+    int64_t value = 1;
+    while (exponent > 0) {
+        if ((exponent & 1) && !checkedMultiply(value, base, value)) return false;
+        exponent >>= 1;
+        // Once the base no longer fits, any remaining bit would overflow too.
+        if (exponent > 0 && !checkedMultiply(base, base, base)) return false;
+    }
+    result = value;
+    return true;
+}
+
+BigInt::BigInt(int64_t value) : negative(value < 0) {
+    // Negated as unsigned, so INT64_MIN works.
+    uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    while (magnitude > 0) {
+        limbs.push_back(static_cast<uint32_t>(magnitude));
+        magnitude >>= 32;
+    }
+}
+
+bool BigInt::parse(std::string_view text, BigInt& result) {
+    result = BigInt();
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) text.remove_prefix(1);
+    if (text.empty()) return false;
+
+    // Nine decimal digits at a time fit one limb multiplication.
+    size_t chunk = text.size() % 9 == 0 ? 9 : text.size() % 9;
+    for (size_t pos = 0; pos < text.size(); pos += chunk, chunk = 9) {
+        uint32_t digits = 0;
+        auto parsed = std::from_chars(text.data() + pos, text.data() + pos + chunk, digits);
+        if (parsed.ec != std::errc() || parsed.ptr != text.data() + pos + chunk) return false;
+
+        uint64_t carry = digits;
+        uint32_t scale = 1;
+        for (size_t i = 0; i < chunk; ++i) scale *= 10;
+        for (uint32_t& limb : result.limbs) {
+            uint64_t product = static_cast<uint64_t>(limb) * scale + carry;
+            limb = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        if (carry > 0) result.limbs.push_back(static_cast<uint32_t>(carry));
+    }
+    result.trim();
+    result.negative = negative && !result.isZero();
+    return true;
+}
+
+BigInt BigInt::fromWhole(double value) {
+    if (std::fabs(value) < 9223372036854775808.0) return BigInt(static_cast<int64_t>(value));
+    // From 2^63 up, a double is its 53-bit mantissa shifted left.
+    int exponent;
+    double fraction = std::frexp(std::fabs(value), &exponent);
+    uint64_t mantissa = static_cast<uint64_t>(std::ldexp(fraction, 53));
+    int shift = exponent - 53;
+    int bits = shift % 32;
+    uint64_t low = mantissa << bits;
+    BigInt result;
+    result.negative = value < 0;
+    result.limbs.assign(static_cast<size_t>(shift / 32), 0);
+    result.limbs.push_back(static_cast<uint32_t>(low));
+    result.limbs.push_back(static_cast<uint32_t>(low >> 32));
+    result.limbs.push_back(bits > 0 ? static_cast<uint32_t>(mantissa >> (64 - bits)) : 0);
+    result.trim();
+    return result;
+}
+
+bool BigInt::fitsInt64() const {
+    if (limbs.size() > 2) return false;
+    uint64_t magnitude = limbs.empty() ? 0 : limbs[0];
+    if (limbs.size() == 2) magnitude |= static_cast<uint64_t>(limbs[1]) << 32;
+    return magnitude <= static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0);
+}
+
+int64_t BigInt::toInt64() const {
+    uint64_t magnitude = limbs.empty() ? 0 : limbs[0];
+    if (limbs.size() == 2) magnitude |= static_cast<uint64_t>(limbs[1]) << 32;
+    return static_cast<int64_t>(negative ? 0 - magnitude : magnitude);
+}
+
+double BigInt::toDouble() const {
+    double result = 0;
+    for (size_t i = limbs.size(); i-- > 0;) {
+        result = result * 4294967296.0 + limbs[i];
+    }
+    return negative ? -result : result;
+}
+
+size_t BigInt::bitLength() const {
+    if (limbs.empty()) return 0;
+    size_t bits = (limbs.size() - 1) * 32;
+    for (uint32_t top = limbs.back(); top > 0; top >>= 1) ++bits;
+    return bits;
+}
+
+void BigInt::appendTo(std::string& out) const {
+    if (limbs.empty()) {
+        out += '0';
+        return;
+    }
+    // Peel off nine decimal digits at a time, least significant first.
+    std::vector<uint32_t> magnitude = limbs;
+    std::vector<uint32_t> groups;
+    while (!magnitude.empty()) {
+        groups.push_back(divideSmall(magnitude, 1000000000));
+    }
+
+    if (negative) out += '-';
+    char buffer[16];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), groups.back());
+    out.append(buffer, result.ptr);
+    for (size_t i = groups.size() - 1; i-- > 0;) {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), groups[i]);
+        out.append(9 - static_cast<size_t>(result.ptr - buffer), '0');
+        out.append(buffer, result.ptr);
+    }
+}
+
+int BigInt::compare(const BigInt& left, const BigInt& right) {
+    if (left.negative != right.negative) return left.negative ? -1 : 1;
+    int order = compareMagnitude(left.limbs, right.limbs);
+    return left.negative ? -order : order;
+}
+
+BigInt BigInt::add(const BigInt& left, const BigInt& right) {
+    BigInt result;
+    if (left.negative == right.negative) {
+        result.limbs = addMagnitude(left.limbs, right.limbs);
+        result.negative = left.negative;
+    } else if (compareMagnitude(left.limbs, right.limbs) >= 0) {
+        result.limbs = subtractMagnitude(left.limbs, right.limbs);
+        result.negative = left.negative;
+    } else {
+        result.limbs = subtractMagnitude(right.limbs, left.limbs);
+        result.negative = right.negative;
+    }
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::subtract(const BigInt& left, const BigInt& right) {
+    BigInt negated = right;
+    negated.negative = !right.negative && !right.isZero();
+    return add(left, negated);
+}
+
+BigInt BigInt::multiply(const BigInt& left, const BigInt& right) {
+    BigInt result;
+    if (left.isZero() || right.isZero()) return result;
+    result.limbs.assign(left.limbs.size() + right.limbs.size(), 0);
+    for (size_t i = 0; i < left.limbs.size(); ++i) {
+        uint64_t carry = 0;
+        for (size_t j = 0; j < right.limbs.size(); ++j) {
+            uint64_t product = static_cast<uint64_t>(left.limbs[i]) * right.limbs[j] + result.limbs[i + j] + carry;
+            result.limbs[i + j] = static_cast<uint32_t>(product);
+            carry = product >> 32;
+        }
+        result.limbs[i + right.limbs.size()] = static_cast<uint32_t>(carry);
+    }
+    result.negative = left.negative != right.negative;
+    result.trim();
+    return result;
+}
+
+bool BigInt::divideExact(const BigInt& left, const BigInt& right, BigInt& quotient) {
+    quotient = BigInt();
+    if (right.limbs.size() == 1) {
+        quotient.limbs = left.limbs;
+        if (divideSmall(quotient.limbs, right.limbs[0]) != 0) return false;
+    } else {
+        // Binary long division: bring down one bit of the dividend at a time.
+        std::vector<uint32_t> remainder;
+        quotient.limbs.assign(left.limbs.size(), 0);
+        for (size_t bit = left.bitLength(); bit-- > 0;) {
+            uint32_t carry = (left.limbs[bit / 32] >> (bit % 32)) & 1;
+            for (uint32_t& limb : remainder) {
+                uint32_t next = limb >> 31;
+                limb = (limb << 1) | carry;
+                carry = next;
+            }
+            if (carry) remainder.push_back(carry);
+            if (compareMagnitude(remainder, right.limbs) >= 0) {
+                remainder = subtractMagnitude(remainder, right.limbs);
+                quotient.limbs[bit / 32] |= 1u << (bit % 32);
+            }
+        }
+        if (!remainder.empty()) return false;
+    }
+    quotient.trim();
+    quotient.negative = left.negative != right.negative && !quotient.isZero();
+    return true;
+}
+
+BigInt BigInt::power(BigInt base, uint64_t exponent) {
+    BigInt result(1);
+    while (exponent > 0) {
+        if (exponent & 1) result = multiply(result, base);
+        exponent >>= 1;
+        if (exponent > 0) base = multiply(base, base);
+    }
+    return result;
+}
+
+void BigInt::trim() {
+    while (!limbs.empty() && limbs.back() == 0) limbs.pop_back();
+    if (limbs.empty()) negative = false;
+}
+
+int BigInt::compareMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right) {
+    if (left.size() != right.size()) return left.size() < right.size() ? -1 : 1;
+    for (size_t i = left.size(); i-- > 0;) {
+        if (left[i] != right[i]) return left[i] < right[i] ? -1 : 1;
+    }
+    return 0;
+}
+
+std::vector<uint32_t> BigInt::addMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right) {
+    const std::vector<uint32_t>& longer = left.size() >= right.size() ? left : right;
+    const std::vector<uint32_t>& shorter = left.size() >= right.size() ? right : left;
+    std::vector<uint32_t> result(longer.size() + 1);
+    uint64_t carry = 0;
+    for (size_t i = 0; i < longer.size(); ++i) {
+        uint64_t sum = static_cast<uint64_t>(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+        result[i] = static_cast<uint32_t>(sum);
+        carry = sum >> 32;
+    }
+    result[longer.size()] = static_cast<uint32_t>(carry);
+    while (!result.empty() && result.back() == 0) result.pop_back();
+    return result;
+}
+
+std::vector<uint32_t> BigInt::subtractMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right) {
+    std::vector<uint32_t> result(left.size());
+    int64_t borrow = 0;
+    for (size_t i = 0; i < left.size(); ++i) {
+        int64_t difference = static_cast<int64_t>(left[i]) - (i < right.size() ? right[i] : 0) - borrow;
+        borrow = difference < 0;
+        result[i] = static_cast<uint32_t>(difference + (borrow << 32));
+    }
+    while (!result.empty() && result.back() == 0) result.pop_back();
+    return result;
+}
+
+uint32_t BigInt::divideSmall(std::vector<uint32_t>& magnitude, uint32_t divisor) {
+    uint64_t remainder = 0;
+    for (size_t i = magnitude.size(); i-- > 0;) {
+        uint64_t current = (remainder << 32) | magnitude[i];
+        magnitude[i] = static_cast<uint32_t>(current / divisor);
+        remainder = current % divisor;
+    }
+    while (!magnitude.empty() && magnitude.back() == 0) magnitude.pop_back();
+    return static_cast<uint32_t>(remainder);
+}
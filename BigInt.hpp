@@ -0,0 +1,93 @@
+#ifndef BIGINT_HPP
+#define BIGINT_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Overflow-checked int64 arithmetic. Each returns false, leaving `result`
+// unspecified, when the exact result does not fit.
+inline bool checkedAdd(int64_t left, int64_t right, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_add_overflow(left, right, &result);
+#else
+    if ((right > 0 && left > INT64_MAX - right) || (right < 0 && left < INT64_MIN - right)) return false;
+    result = left + right;
+    return true;
+#endif
+}
+
+inline bool checkedSubtract(int64_t left, int64_t right, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_sub_overflow(left, right, &result);
+#else
+    if ((right < 0 && left > INT64_MAX + right) || (right > 0 && left < INT64_MIN + right)) return false;
+    result = left - right;
+    return true;
+#endif
+}
+
+inline bool checkedMultiply(int64_t left, int64_t right, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return !__builtin_mul_overflow(left, right, &result);
+#else
+    if (left == 0 || right == 0) {
+        result = 0;
+        return true;
+    }
+    if ((left == -1 && right == INT64_MIN) || (right == -1 && left == INT64_MIN)) return false;
+    if (left > 0 ? (right > 0 ? left > INT64_MAX / right : right < INT64_MIN / left)
+                 : (right > 0 ? left < INT64_MIN / right : left < INT64_MAX / right)) {
+        return false;
+    }
+    result = left * right;
+    return true;
+#endif
+}
+
+// Exponentiation by squaring; `exponent` must not be negative.
+bool checkedPower(int64_t base, int64_t exponent, int64_t& result);
+
+// An arbitrary-precision integer: a sign and a magnitude in base 2^32 limbs,
+// least significant first, with no leading zero limbs (zero has none).
+class BigInt {
+public:
+    BigInt() = default;
+    explicit BigInt(int64_t value);
+
+    // Parses an optional '-' followed by decimal digits.
+    static bool parse(std::string_view text, BigInt& result);
+    // `value` must be finite and whole.
+    static BigInt fromWhole(double value);
+
+    bool isZero() const { return limbs.empty(); }
+    bool isNegative() const { return negative; }
+    bool fitsInt64() const;
+    int64_t toInt64() const;
+    double toDouble() const;
+    size_t bitLength() const;
+    void appendTo(std::string& out) const;
+
+    static int compare(const BigInt& left, const BigInt& right);
+    static BigInt add(const BigInt& left, const BigInt& right);
+    static BigInt subtract(const BigInt& left, const BigInt& right);
+    static BigInt multiply(const BigInt& left, const BigInt& right);
+    // Returns false if `right` does not divide `left`; `right` must not be zero.
+    static bool divideExact(const BigInt& left, const BigInt& right, BigInt& quotient);
+    static BigInt power(BigInt base, uint64_t exponent);
+
+private:
+    bool negative = false;
+    std::vector<uint32_t> limbs;
+
+    void trim();
+    static int compareMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right);
+    static std::vector<uint32_t> addMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right);
+    // `left` must be at least `right`.
+    static std::vector<uint32_t> subtractMagnitude(const std::vector<uint32_t>& left, const std::vector<uint32_t>& right);
+    // Divides in place and returns the remainder.
+    static uint32_t divideSmall(std::vector<uint32_t>& magnitude, uint32_t divisor);
+};
+
+#endif
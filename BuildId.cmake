@@ -0,0 +1,13 @@
+# Writes OUTPUT, a header defining SYNZE_BUILD_ID as VERSION followed by a
+# hash of the files in SOURCES (separated by '|'). Caches and snapshots record
+# the id, so any change to the interpreter's sources invalidates them.
+string(REPLACE "|" ";" sources "${SOURCES}")
+set(digests "")
+foreach(source ${sources})
+    file(SHA256 ${source} digest)
+    string(APPEND digests ${digest})
+endforeach()
+string(SHA256 hash "${digests}")
+string(SUBSTRING ${hash} 0 16 hash)
+
+file(WRITE ${OUTPUT} "// Generated by BuildId.cmake.\n#define SYNZE_BUILD_ID \"${VERSION}-${hash}\"\n")
@@ -0,0 +1,78 @@
+#ifndef BYTECODE_HPP
+#define BYTECODE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "Ast.hpp"
+#include "Value.hpp"
+
+enum class OpCode : uint8_t {
+    PushConstant,   // push constants[operand]
+    LoadLocal,      // push local slot operand of the current call
+    LoadGlobal,     // push global slot operand
+    StoreLocal,     // pop into local slot operand
+    StoreGlobal,    // pop into global slot operand
+    ReadInput,      // push a line of input, typed like `x = input`
+    ReadLine,       // push a line of input as a string
+    Interpolate,    // push the text of templates[operand]
+    MakeArray,      // pop `operand` numbers and push them as an array
+    Index,          // pop an index and an array, push the element
+    CallBuiltin,    // pop `count` arguments and push the result of Builtin operand
+    Add,            // Add..Power pop two operands and push the result
+    Subtract,
+    Multiply,
+    Divide,
+    Power,
+    Equal,          // Equal..GreaterEqual are ordered like CompareOp
+    NotEqual,
+    Less,
+    Greater,
+    LessEqual,
+    GreaterEqual,
+    Jump,           // continue at operand
+    JumpIfFalse,    // pop a condition, continue at operand when it is false
+    ForPrepare,     // check that the range bounds below the top are numbers; they stay as counter, end
+    ForTest,        // push the counter if it is below end, otherwise continue at operand
+    ForNext,        // add 1 to the counter and continue at operand
+    Pop,            // drop the top `count` values
+    Send,           // pop and print
+    SendTemplate,   // print the text of templates[operand]
+    CallLocal,      // call the function in local slot operand with the top `count` values
+    CallGlobal,     // call the function in global slot operand with the top `count` values
+    TailCallLocal,  // like CallLocal and CallGlobal, but the callee replaces the current call
+    TailCallGlobal,
+    Return,
+    DefineFunction, // store functions[operand] in its slot
+    Run,            // run the file named by constants[operand]
+    Import,         // import the file named by constants[operand] as constants[operand + 1]
+    Exit,
+    Line            // report that the statement on line operand starts (profiling only)
+};
+
+struct Instruction {
+    OpCode op;
+    uint16_t count;
+    int32_t operand;
+};
+
+// Bytecode for one top-level statement or one function body. Every chunk
+// ends with Return.
+struct ChunkFunction {
+    std::shared_ptr<const FunctionDef> definition;
+    Slot slot;
+};
+
+struct Chunk {
+    std::vector<Instruction> code;
+    std::vector<int> lines;
+    std::vector<Value> constants;
+    std::vector<ChunkFunction> functions;
+    // Interpolated strings point into the AST, which outlives the chunk: a
+    // statement's chunk runs while its program is alive, and function
+    // bytecode is owned alongside the definition it was compiled from.
+    std::vector<const TemplateExpr*> templates;
+};
+
+#endif
@@ -0,0 +1,224 @@
+#include "Compiler.hpp"
+#include <limits>
+#include <stdexcept>
+
+std::shared_ptr<Chunk> Compiler::compileStatement(const Stmt& stmt) {
+    auto result = std::make_shared<Chunk>();
+    chunk = result.get();
+    compile(stmt);
+    emit(OpCode::Return, stmt.line);
+    return result;
+}
+
+std::shared_ptr<Chunk> Compiler::compileFunction(const FunctionDef& function) {
+    auto result = std::make_shared<Chunk>();
+    chunk = result.get();
+    compileBlock(function.body, true);
+    emit(OpCode::Return, function.body.empty() ? 0 : function.body.back()->line);
+    return result;
+}
+
+void Compiler::compileBlock(const Block& block, bool tail) {
+    for (size_t i = 0; i < block.size(); ++i) {
+        compile(*block[i], tail && i + 1 == block.size());
+    }
+}
+
+void Compiler::compile(const Stmt& stmt, bool tail) {
+    if (lineEvents) emit(OpCode::Line, stmt.line, stmt.line);
+    switch (stmt.kind) {
+        case Stmt::Kind::Send: {
+            const Expr& value = *static_cast<const SendStmt&>(stmt).value;
+            if (value.kind == Expr::Kind::Template) {
+                emit(OpCode::SendTemplate, stmt.line, addTemplate(static_cast<const TemplateExpr&>(value)));
+            } else {
+                compile(value);
+                emit(OpCode::Send, stmt.line);
+            }
+            break;
+        }
+        case Stmt::Kind::Assign: {
+            const auto& assign = static_cast<const AssignStmt&>(stmt);
+            compile(*assign.value);
+            emitStore(assign.slot, stmt.line);
+            break;
+        }
+        case Stmt::Kind::Call: {
+            const auto& call = static_cast<const CallStmt&>(stmt);
+            if (call.args.size() > std::numeric_limits<uint16_t>::max()) {
+                throw std::runtime_error("Too many arguments in call to '" + call.name + "'.");
+            }
+            for (const ExprPtr& arg : call.args) {
+                compile(*arg);
+            }
+            OpCode op = tail ? (call.callee.local ? OpCode::TailCallLocal : OpCode::TailCallGlobal)
+                             : (call.callee.local ? OpCode::CallLocal : OpCode::CallGlobal);
+            emit(op, stmt.line,
+                 static_cast<int32_t>(call.callee.index), static_cast<uint16_t>(call.args.size()));
+            break;
+        }
+        case Stmt::Kind::FuncDef: {
+            const auto& def = static_cast<const FuncDefStmt&>(stmt);
+            chunk->functions.push_back({ def.function, def.slot });
+            emit(OpCode::DefineFunction, stmt.line, static_cast<int32_t>(chunk->functions.size() - 1));
+            break;
+        }
+        case Stmt::Kind::If: {
+            const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+            std::vector<size_t> exits;
+            for (const IfBranch& branch : ifStmt.branches) {
+                compile(*branch.condition);
+                size_t skip = emit(OpCode::JumpIfFalse, stmt.line);
+                compileBlock(branch.body, tail);
+                exits.push_back(emit(OpCode::Jump, stmt.line));
+                patchJump(skip);
+            }
+            compileBlock(ifStmt.elseBody, tail);
+            for (size_t at : exits) {
+                patchJump(at);
+            }
+            break;
+        }
+        case Stmt::Kind::While: {
+            const auto& whileStmt = static_cast<const WhileStmt&>(stmt);
+            size_t loop = chunk->code.size();
+            compile(*whileStmt.condition);
+            size_t exit = emit(OpCode::JumpIfFalse, stmt.line);
+            compileBlock(whileStmt.body);
+            emit(OpCode::Jump, stmt.line, static_cast<int32_t>(loop));
+            patchJump(exit);
+            break;
+        }
+        case Stmt::Kind::For: {
+            // The counter and end bound live on the stack for the whole loop;
+            // each iteration copies the counter into the loop variable's slot.
+            const auto& forStmt = static_cast<const ForStmt&>(stmt);
+            compile(*forStmt.start);
+            compile(*forStmt.end);
+            emit(OpCode::ForPrepare, stmt.line);
+            size_t loop = emit(OpCode::ForTest, stmt.line);
+            emitStore(forStmt.slot, stmt.line);
+            compileBlock(forStmt.body);
+            emit(OpCode::ForNext, stmt.line, static_cast<int32_t>(loop));
+            patchJump(loop);
+            emit(OpCode::Pop, stmt.line, 0, 2);
+            break;
+        }
+        case Stmt::Kind::Run:
+            emit(OpCode::Run, stmt.line, addConstant(Value::string(static_cast<const RunStmt&>(stmt).path)));
+            break;
+        case Stmt::Kind::Import: {
+            const auto& import = static_cast<const ImportStmt&>(stmt);
+            int32_t path = addConstant(Value::string(import.path));
+            addConstant(Value::string(import.name));
+            emit(OpCode::Import, stmt.line, path);
+            break;
+        }
+        case Stmt::Kind::Exit:
+            emit(OpCode::Exit, stmt.line);
+            break;
+    }
+}
+
+void Compiler::compile(const Expr& expr) {
+    switch (expr.kind) {
+        case Expr::Kind::Literal:
+            emit(OpCode::PushConstant, expr.line, addConstant(static_cast<const LiteralExpr&>(expr).value));
+            break;
+        case Expr::Kind::Template:
+            emit(OpCode::Interpolate, expr.line, addTemplate(static_cast<const TemplateExpr&>(expr)));
+            break;
+        case Expr::Kind::Variable:
+            emitLoad(static_cast<const VariableExpr&>(expr).slot, expr.line);
+            break;
+        case Expr::Kind::Input: {
+            const auto& input = static_cast<const InputExpr&>(expr);
+            if (input.target.empty()) {
+                emit(OpCode::ReadInput, expr.line);
+            } else {
+                emit(OpCode::ReadLine, expr.line);
+                emitStore(input.slot, expr.line);
+                emit(OpCode::PushConstant, expr.line, addConstant(Value::string("")));
+            }
+            break;
+        }
+        case Expr::Kind::Binary: {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            compile(*binary.left);
+            compile(*binary.right);
+            switch (binary.op) {
+                case '+': emit(OpCode::Add, expr.line); break;
+                case '-': emit(OpCode::Subtract, expr.line); break;
+                case '*': emit(OpCode::Multiply, expr.line); break;
+                case '/': emit(OpCode::Divide, expr.line); break;
+                default: emit(OpCode::Power, expr.line); break;
+            }
+            break;
+        }
+        case Expr::Kind::Compare: {
+            const auto& compare = static_cast<const CompareExpr&>(expr);
+            compile(*compare.left);
+            compile(*compare.right);
+            switch (compare.op) {
+                case CompareOp::Equal: emit(OpCode::Equal, expr.line); break;
+                case CompareOp::NotEqual: emit(OpCode::NotEqual, expr.line); break;
+                case CompareOp::Less: emit(OpCode::Less, expr.line); break;
+                case CompareOp::Greater: emit(OpCode::Greater, expr.line); break;
+                case CompareOp::LessEqual: emit(OpCode::LessEqual, expr.line); break;
+                case CompareOp::GreaterEqual: emit(OpCode::GreaterEqual, expr.line); break;
+            }
+            break;
+        }
+        case Expr::Kind::Array: {
+            const auto& elements = static_cast<const ArrayExpr&>(expr).elements;
+            for (const ExprPtr& element : elements) {
+                compile(*element);
+            }
+            emit(OpCode::MakeArray, expr.line, static_cast<int32_t>(elements.size()));
+            break;
+        }
+        case Expr::Kind::Index: {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            compile(*index.target);
+            compile(*index.index);
+            emit(OpCode::Index, expr.line);
+            break;
+        }
+        case Expr::Kind::Builtin: {
+            const auto& call = static_cast<const BuiltinExpr&>(expr);
+            for (const ExprPtr& arg : call.args) {
+                compile(*arg);
+            }
+            emit(OpCode::CallBuiltin, expr.line, static_cast<int32_t>(call.builtin), static_cast<uint16_t>(call.args.size()));
+            break;
+        }
+    }
+}
+
+size_t Compiler::emit(OpCode op, int line, int32_t operand, uint16_t count) {
+    chunk->code.push_back({ op, count, operand });
+    chunk->lines.push_back(line);
+    return chunk->code.size() - 1;
+}
+
+void Compiler::patchJump(size_t at) {
+    chunk->code[at].operand = static_cast<int32_t>(chunk->code.size());
+}
+
+void Compiler::emitLoad(Slot slot, int line) {
+    emit(slot.local ? OpCode::LoadLocal : OpCode::LoadGlobal, line, static_cast<int32_t>(slot.index));
+}
+
+void Compiler::emitStore(Slot slot, int line) {
+    emit(slot.local ? OpCode::StoreLocal : OpCode::StoreGlobal, line, static_cast<int32_t>(slot.index));
+}
+
+int32_t Compiler::addTemplate(const TemplateExpr& expr) {
+    chunk->templates.push_back(&expr);
+    return static_cast<int32_t>(chunk->templates.size() - 1);
+}
+
+int32_t Compiler::addConstant(Value value) {
+    chunk->constants.push_back(std::move(value));
+    return static_cast<int32_t>(chunk->constants.size() - 1);
+}
@@ -0,0 +1,36 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include <memory>
+#include <string>
+#include "Ast.hpp"
+#include "Bytecode.hpp"
+
+// Lowers parsed statements to bytecode for the VM.
+class Compiler {
+public:
+    // With line events every statement starts with a Line instruction for the profiler.
+    explicit Compiler(bool lineEvents = false) : lineEvents(lineEvents) {}
+
+    std::shared_ptr<Chunk> compileStatement(const Stmt& stmt);
+    std::shared_ptr<Chunk> compileFunction(const FunctionDef& function);
+
+private:
+    Chunk* chunk = nullptr;
+    bool lineEvents;
+
+    // In tail position a call is the last thing its function does, so it is
+    // compiled to replace the current call rather than nest inside it.
+    void compileBlock(const Block& block, bool tail = false);
+    void compile(const Stmt& stmt, bool tail = false);
+    void compile(const Expr& expr);
+
+    size_t emit(OpCode op, int line, int32_t operand = 0, uint16_t count = 0);
+    void patchJump(size_t at);
+    void emitLoad(Slot slot, int line);
+    void emitStore(Slot slot, int line);
+    int32_t addConstant(Value value);
+    int32_t addTemplate(const TemplateExpr& expr);
+};
+
+#endif
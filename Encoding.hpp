@@ -0,0 +1,135 @@
+#ifndef ENCODING_HPP
+#define ENCODING_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include "BuildId.hpp"
+
+#if defined(_WIN32)
+#include <process.h>
+#define SYNZE_PROCESS_ID _getpid()
+#else
+#include <unistd.h>
+#define SYNZE_PROCESS_ID getpid()
+#endif
+
+// Primitives shared by the binary formats: program caches and snapshots.
+// Values are stored in host byte order; each format's header records a byte
+// order mark, so a file from another platform is rejected as a whole.
+
+// Every header also records the interpreter build that wrote the file, zero
+// padded, and files from any other build are refused. See BuildId.cmake.
+const char buildId[32] = SYNZE_BUILD_ID;
+
+template <typename T>
+void put(std::string& out, T value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Counts, indexes and line numbers are small, so they are stored as LEB128
+// varints.
+inline void putIndex(std::string& out, uint32_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+inline void putString(std::string& out, std::string_view text) {
+    putIndex(out, static_cast<uint32_t>(text.size()));
+    out += text;
+}
+
+// FNV-style mixing over 8-byte words; the tail is folded in byte by byte.
+inline uint64_t hashBytes(std::string_view bytes) {
+    const uint64_t prime = 0x100000001b3ull;
+    uint64_t hash = 0xcbf29ce484222325ull ^ bytes.size();
+    size_t i = 0;
+    for (; i + 8 <= bytes.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, bytes.data() + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < bytes.size(); ++i) {
+        hash = (hash ^ static_cast<unsigned char>(bytes[i])) * prime;
+    }
+    return hash;
+}
+
+// Writes `header` then `payload` to a temporary beside `path` and renames it
+// into place, so a process starting meanwhile never maps a half-written file.
+// The temporary is named after the process id and a count within the process,
+// so concurrent writers never share one. Returns false, removing the
+// temporary, if either step fails.
+inline bool replaceFile(const std::string& path, std::string_view header, std::string_view payload) {
+    static std::atomic<uint64_t> sequence{ 0 };
+    std::string temporary = path + ".tmp" + std::to_string(SYNZE_PROCESS_ID) + "-" + std::to_string(sequence++);
+    std::error_code error;
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+        out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+        if (!out) {
+            out.close();
+            std::filesystem::remove(temporary, error);
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        return false;
+    }
+    return true;
+}
+
+// Reads what the functions above wrote. Running past the end or reading a
+// malformed varint throws std::runtime_error with `error`.
+class ByteReader {
+public:
+    ByteReader(std::string_view bytes, const char* error)
+        : pos(bytes.data()), end(bytes.data() + bytes.size()), error(error) {}
+
+    [[noreturn]] void fail() const { throw std::runtime_error(error); }
+    bool atEnd() const { return pos == end; }
+
+    template <typename T>
+    T get() {
+        if (static_cast<size_t>(end - pos) < sizeof(T)) fail();
+        T value;
+        std::memcpy(&value, pos, sizeof(T));
+        pos += sizeof(T);
+        return value;
+    }
+    uint32_t getIndex() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            uint8_t byte = get<uint8_t>();
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        fail();
+    }
+    std::string getString() {
+        uint32_t length = getIndex();
+        if (static_cast<size_t>(end - pos) < length) fail();
+        std::string text(pos, length);
+        pos += length;
+        return text;
+    }
+
+private:
+    const char* pos;
+    const char* end;
+    const char* error;
+};
+
+#endif
@@ -1,569 +1,981 @@
 #include "Interpreter.hpp"
+#include "ArrayKernels.hpp"
+#include "Compiler.hpp"
+#include "Lexer.hpp"
+#include "Optimizer.hpp"
+#include "Parser.hpp"
+#include "Purity.hpp"
+#include "Resolver.hpp"
+#include "ScriptError.hpp"
+#include "Snapshot.hpp"
+#include "SourceFile.hpp"
+#include "VM.hpp"
 #include <iostream>
-#include <fstream>
-#include <thread>
-#include <sstream>
 #include <stdexcept>
 #include <iomanip>
 #include <algorithm>
 #include <chrono>
 #include <cmath>
+#include <cstdlib>
 
-void Interpreter::execute(const std::string& line) {
-    std::vector<Token> tokens = tokenize(line);
-    static int currentIndentationLevel = 0;
-    static std::vector<std::string> bufferedFunctionLines;
-    static bool capturingFunction = false;
-    static std::string currentFunctionName;
-    static std::vector<std::string> currentFunctionParams;
-    static std::vector<std::string> bufferedBlockLines;
-    static bool capturingBlock = false;
-    static std::string blockType;
-    static bool conditionMatched = false;
-
-    int lineIndentation = getIndentationLevel(line);
-
-    if (capturingFunction && lineIndentation <= currentIndentationLevel) {
-        functions[currentFunctionName] = { currentFunctionParams, bufferedFunctionLines };
-        bufferedFunctionLines.clear();
-        capturingFunction = false;
-    }
-    if (capturingBlock && lineIndentation <= currentIndentationLevel) {
-        if (blockType == "if" || blockType == "else if") {
-            if (!conditionMatched && evaluateCondition(bufferedBlockLines[0])) {
-                for (size_t i = 1; i < bufferedBlockLines.size(); ++i) {
-                    execute(bufferedBlockLines[i]);
-                }
-                conditionMatched = true;
-            }
-        } else if (blockType == "else" && !conditionMatched) {
-            for (const auto& blockLine : bufferedBlockLines) {
-                execute(blockLine);
-            }
-            conditionMatched = true;
-        }
+namespace {
 
-        bufferedBlockLines.clear();
-        capturingBlock = false;
-    }
+// Exact powers are computed up to this many bits; larger ones use floating point.
+const size_t maxPowerBits = 1 << 20;
 
-    if (tokens.empty()) return;
-    if (tokens[0].type == COMMENT) return;
-    if (tokens[0].value == "if" || tokens[0].value == "else if" || tokens[0].value == "else") {
-        if (capturingBlock) {
-            throw std::runtime_error("Unexpected control structure inside an existing block.");
-        }
+std::string scriptPath(const std::string& filePath) {
+    std::string path = filePath;
+    std::replace(path.begin(), path.end(), '\\', '/');
+    if (path.size() < 7 || path.substr(path.size() - 6) != ".synze") {
+        throw std::runtime_error("Invalid file extension. Expected .synze");
+    }
+    return path;
+}
 
-        blockType = tokens[0].value;
-        capturingBlock = true;
-        currentIndentationLevel = lineIndentation;
-        conditionMatched = (blockType == "else") ? conditionMatched : false;
+template <typename T>
+bool compareOrdered(CompareOp op, const T& left, const T& right) {
+    switch (op) {
+        case CompareOp::Equal: return left == right;
+        case CompareOp::NotEqual: return left != right;
+        case CompareOp::Less: return left < right;
+        case CompareOp::Greater: return left > right;
+        case CompareOp::LessEqual: return left <= right;
+        default: return left >= right;
+    }
+}
 
-        if (tokens[0].value != "else") {
-            bufferedBlockLines.push_back(trim(line));
-        }
+}
 
-        return;
+void Interpreter::execute(const std::string& line) {
+    try {
+        executeLine(line);
+    } catch (const ExitRequest&) {
+        exitRequested = true;
     }
+}
 
-    else if (capturingBlock) {
-        if (lineIndentation > currentIndentationLevel) {
-            bufferedBlockLines.push_back(trim(line));
-        } else {
-            throw std::runtime_error("Unexpected indentation in conditional block.");
-        }
-        return;
+void Interpreter::handleRunCommand(const std::string& filePath) {
+    try {
+        runFile(filePath);
+    } catch (const ExitRequest&) {
+        exitRequested = true;
     }
+}
 
-    else if (tokens[0].type == FUNC) {
-        if (tokens.size() < 2 || tokens[1].type != IDENTIFIER) {
-            throw std::runtime_error("Invalid function definition. Syntax: func name param1, param2");
-        }
+void Interpreter::executeSource(std::string_view source, const std::string& name) {
+    try {
+        runSource(source, name, false);
+    } catch (const ExitRequest&) {
+        exitRequested = true;
+    }
+}
 
-        currentFunctionName = tokens[1].value;
+void Interpreter::setGlobal(const std::string& name, Value value) {
+    uint32_t id = symbols.intern(name);
+    globals.resize(symbols.size());
+    globals[id] = std::move(value);
+}
 
-        currentFunctionParams.clear();
-        for (size_t i = 2; i < tokens.size(); ++i) {
-            if (tokens[i].type == IDENTIFIER) {
-                currentFunctionParams.push_back(tokens[i].value);
-            } else if (tokens[i].value != ",") {
-                throw std::runtime_error("Invalid parameter syntax in function definition.");
-            }
-        }
+Value Interpreter::getGlobal(const std::string& name) const {
+    uint32_t id;
+    return symbols.find(name, id) && id < globals.size() ? globals[id] : Value();
+}
 
-        capturingFunction = true;
-        currentIndentationLevel = lineIndentation;
-        return;
-    }
+Interpreter::GlobalSlot Interpreter::globalSlot(const std::string& name) {
+    uint32_t id = symbols.intern(name);
+    globals.resize(symbols.size());
+    return { id };
+}
 
-    if (capturingFunction) {
-        if (lineIndentation > currentIndentationLevel) {
-            bufferedFunctionLines.push_back(trim(line));
-        } else {
-            throw std::runtime_error("Unexpected indentation in function body.");
-        }
-        return;
-    }
+void Interpreter::defineNative(const std::string& name, std::vector<NativeType> params, std::function<void(NativeCall&)> body) {
+    auto function = std::make_shared<NativeFunction>();
+    function->name = name;
+    function->params = std::move(params);
+    function->body = std::move(body);
+    setGlobal(name, Value::native(std::move(function)));
+}
 
-    if (functions.find(tokens[0].value) != functions.end()) {
-        handleFunctionCall(tokens);
-    }
-    else if (tokens[0].type == SEND && tokens.size() > 1) {
-        std::string output = handleSendCommand(tokens);
-        std::cout << output << std::endl;
+void Interpreter::saveSnapshot(const std::string& path) const {
+    Snapshot snapshot;
+    for (uint32_t id = 0; id < globals.size(); ++id) {
+        const Value& value = globals[id];
+        if (!value.isDefined() || (value.isFunction() && value.asFunction().native)) continue;
+        snapshot.globals.push_back({ id, value });
     }
-    else if (tokens[0].type == RUN && tokens.size() == 2) {
-        handleRunCommand(tokens[1].value);
+    for (const auto& entry : modules) {
+        snapshot.modules.push_back({ entry.first, static_cast<int64_t>(entry.second.modified.time_since_epoch().count()),
+                                     entry.second.names });
     }
-    else if (tokens[0].type == IDENTIFIER && tokens.size() >= 3 && tokens[1].type == ASSIGNMENT) {
-        handleVariableDeclaration(tokens);
+    writeSnapshot(path, symbols, snapshot);
+}
+
+void Interpreter::loadSnapshot(const std::string& path) {
+    Snapshot snapshot = readSnapshot(path, symbols);
+    globals.resize(symbols.size());
+    for (Snapshot::Global& global : snapshot.globals) {
+        globals[global.id] = std::move(global.value);
     }
-    else if (tokens[0].type == EXIT) {
-        std::cout << "\x1B[2JExiting the interpreter." << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(750));
-        std::cout << "\x1B[2JGoodbye!" << std::endl;
-        std::this_thread::sleep_for(std::chrono::milliseconds(750));
-        exit(0);
+    for (Snapshot::Module& module : snapshot.modules) {
+        auto modified = std::filesystem::file_time_type(std::filesystem::file_time_type::duration(module.modified));
+        modules[module.path] = { modified, std::move(module.names) };
     }
 }
 
-void Interpreter::handleVariableDeclaration(const std::vector<Token>& tokens) {
-    std::string varName = tokens[0].value;
-    Token valueToken = tokens[2];
-
-    if (variables.find(varName) != variables.end()) {
-        std::cerr << "Warning: Variable '" << varName
-                  << "' already declared. Overwriting the previous value." << std::endl;
+void Interpreter::setScriptArguments(const std::vector<std::string>& arguments) {
+    setGlobal("argCount", Value::integer(static_cast<int64_t>(arguments.size())));
+    for (size_t i = 0; i < arguments.size(); ++i) {
+        setGlobal("arg" + std::to_string(i + 1), parseInput(arguments[i]));
     }
+}
 
-    if (valueToken.type == STRING_LITERAL) {
-        variables[varName] = { "string", valueToken.value };
-    } else if (valueToken.type == NUMBER) {
-        variables[varName] = { "number", valueToken.value };
-    } else if (valueToken.value == "true" || valueToken.value == "false") {
-        variables[varName] = { "boolean", valueToken.value };
-    } else if (valueToken.value == "input") {
-        std::string inputValue;
-        std::getline(std::cin, inputValue);
+void Interpreter::executeLine(const std::string& line) {
+    TokenStream stream = tokenize(line);
+    const Token* first = stream.lines.empty() ? nullptr : &stream.tokens[0];
 
-        if (inputValue == "true" || inputValue == "false") {
-            variables[varName] = { "boolean", inputValue };
-        } else if (std::all_of(inputValue.begin(), inputValue.end(),
-                               [](char c) { return std::isdigit(c) || c == '.'; })) {
-            variables[varName] = { "number", inputValue };
-        } else {
-            variables[varName] = { "string", inputValue };
+    // Function bodies, if/else chains and loops span several REPL lines; collect them
+    // until a line returns to the outer indentation, then run the whole block.
+    if (capturingBlock) {
+        if (first && (stream.lines[0].indent > 0 || first->type == ELSE)) {
+            pendingSource += line;
+            pendingSource += '\n';
+            return;
         }
-    } else if (valueToken.type == IDENTIFIER) {
-        auto it = variables.find(valueToken.value);
-        if (it == variables.end()) {
-            throw std::runtime_error("Undefined variable: " + valueToken.value);
+        // Comment-only lines neither extend nor end the block.
+        if (!first && line.find_first_not_of(" \t\r") != std::string::npos) return;
+
+        std::string source;
+        source.swap(pendingSource);
+        capturingBlock = false;
+        Program program = parseProgram(source);
+        for (const StmtPtr& stmt : program.statements) {
+            executeTopLevel(*stmt);
         }
-        variables[varName] = it->second;
-    } else {
-        throw std::runtime_error("Unsupported value type for variable declaration.");
+    }
+
+    if (!first) return;
+
+    if (first->type == FUNC || first->type == PURE || first->type == IF || first->type == WHILE || first->type == FOR) {
+        pendingSource = line + '\n';
+        capturingBlock = true;
+        return;
+    }
+
+    Program program = parseProgram(line);
+    for (const StmtPtr& stmt : program.statements) {
+        executeTopLevel(*stmt);
     }
 }
 
-void Interpreter::handleRunCommand(const std::string& filePath) {
+void Interpreter::runFile(const std::string& filePath) {
     auto start = std::chrono::high_resolution_clock::now();
 
-    std::string normalizedPath = filePath;
-    std::replace(normalizedPath.begin(), normalizedPath.end(), '\\', '/');
+    std::string normalizedPath = scriptPath(filePath);
+    SourceFile file(normalizedPath);
+    runSource(file.text(), normalizedPath, cacheEnabled);
 
-    if (normalizedPath.size() < 7 || normalizedPath.substr(normalizedPath.size() - 6) != ".synze") {
-        throw std::runtime_error("Invalid file extension. Expected .synze");
-    }
+    if (!runSummaries) return;
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    output->write("\nSuccessfully executed file: " + normalizedPath + " in " + std::to_string(duration) + "ms\n");
+    output->endLine();
+}
 
-    std::ifstream file(normalizedPath);
-    if (!file.is_open()) {
-        throw std::runtime_error("Unable to open file: " + normalizedPath);
+void Interpreter::importModule(const std::string& filePath, const std::string& name) {
+    std::string path = scriptPath(filePath);
+    std::error_code error;
+    auto modified = std::filesystem::last_write_time(path, error);
+    if (error) throw std::runtime_error("Unable to open file: " + path);
+
+    // Recorded before running, so a module that imports itself is not reloaded.
+    Module& module = modules[path];
+    if (module.modified != modified) {
+        module.modified = modified;
+        module.names.clear();
+    } else if (std::find(module.names.begin(), module.names.end(), name) != module.names.end()) {
+        return;
+    }
+    module.names.push_back(name);
+
+    SourceFile file(path);
+    std::string enclosing = std::move(currentModule);
+    currentModule = name;
+    try {
+        runSource(file.text(), path, cacheEnabled);
+    } catch (...) {
+        currentModule = std::move(enclosing);
+        throw;
     }
+    currentModule = std::move(enclosing);
+}
 
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.empty() || std::all_of(line.begin(), line.end(), ::isspace)) continue;
+void Interpreter::runSource(std::string_view source, const std::string& path, bool cacheable) {
+    Scope callerScope = treeScope;
+    treeScope = Scope();
+    if (profiler) profiler->enterFile(path);
+
+    // Each chunk is parsed, run and freed before the next one is read. A
+    // syntax error stops the file at the chunk that contains it.
+    size_t offset = 0;
+    int firstLine = 1;
+    while (offset < source.size()) {
+        size_t chunkEnd = nextChunkEnd(source, offset, parseBudget);
+        std::string_view chunk = source.substr(offset, chunkEnd - offset);
+
+        Program program;
         try {
-            execute(line);
-        } catch (const std::exception& e) {
-            std::cerr << "Error in line \"" << line << "\": " << e.what() << std::endl;
+            bool wholeFile = chunk.size() == source.size();
+            program = cacheable && wholeFile ? loadProgram(path, source) : parseProgram(chunk, path, firstLine);
+        } catch (const ScriptError& e) {
+            reportError(path, e.line(), e.what());
+            treeScope = callerScope;
+            if (profiler) profiler->exitFile();
+            return;
+        }
+
+        for (const StmtPtr& stmt : program.statements) {
+            try {
+                executeTopLevel(*stmt);
+            } catch (const ScriptError& e) {
+                reportError(e.file().empty() ? path : e.file(), e.line(), e.what());
+            } catch (const std::exception& e) {
+                reportError(path, stmt->line, e.what());
+            } catch (const ExitRequest&) {
+                treeScope = callerScope;
+                if (profiler) profiler->exitFile();
+                throw;
+            }
         }
+
+        firstLine += static_cast<int>(std::count(chunk.begin(), chunk.end(), '\n'));
+        offset = chunkEnd;
     }
 
-    file.close();
+    treeScope = callerScope;
+    if (profiler) profiler->exitFile();
+}
 
-    auto end = std::chrono::high_resolution_clock::now();
-    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
-    std::cout << "\nSuccessfully executed file: " << normalizedPath << " in " << duration << "ms\n" << std::endl;
+Program Interpreter::parseProgram(std::string_view source, const std::string& file, int firstLine) {
+    Program program = Parser(source, firstLine).parse();
+    resolveProgram(program, file);
+    return program;
 }
 
-std::string Interpreter::handleSendCommand(const std::vector<Token>& tokens) {
-    std::ostringstream output;
-    double mathResult = 0;
-    bool isMathMode = false;
-    char currentOperator = '+';
-    bool mathStarted = false;
-    bool insideString = false;
-    std::ostringstream tempString;
+Program Interpreter::loadProgram(const std::string& path, std::string_view source) {
+    Program program;
+    if (!programCache.load(path, source, program)) {
+        program = Parser(source).parse();
+        programCache.store(path, source, program);
+    }
+    resolveProgram(program, path);
+    return program;
+}
 
-    for (size_t i = 1; i < tokens.size(); ++i) {
-        const std::string& tokenValue = tokens[i].value;
+void Interpreter::resolveProgram(Program& program, const std::string& file) {
+    Resolver(symbols, file, currentModule).resolve(program);
+    globals.resize(symbols.size());
+    Optimizer(optimizationLevel).optimize(program);
+    markPureFunctions(program, symbols);
+    if (dumpPrograms) {
+        output->flush();
+        errors->write("# " + (file.empty() ? std::string("<repl>") : file) + ", --opt=" + std::to_string(optimizationLevel) + "\n");
+        errors->write(formatProgram(program));
+        errors->endBlock();
+    }
+}
 
-        if (tokens[i].type == STRING_LITERAL) {
-            if (!insideString) {
-                insideString = true;
-                tempString.str("");
-            }
+void Interpreter::executeTopLevel(const Stmt& stmt) {
+    if (firstStatementTime.time_since_epoch().count() == 0) firstStatementTime = std::chrono::steady_clock::now();
+    if (engine == Engine::Tree) {
+        runTree(stmt);
+        output->endBlock();
+        return;
+    }
 
-            for (size_t j = 0; j < tokens[i].value.size(); ++j) {
-                if (tokens[i].value[j] == '{') {
-                    size_t k = j + 1;
-                    std::string varName;
-                    while (k < tokens[i].value.size() && tokens[i].value[k] != '}') {
-                        varName += tokens[i].value[k++];
-                    }
-                    if (k == tokens[i].value.size() || tokens[i].value[k] != '}') {
-                        throw std::runtime_error("Unmatched '{' in string.");
-                    }
-                    j = k;
-
-                    auto it = variables.find(varName);
-                    if (it == variables.end()) {
-                        throw std::runtime_error("Undefined variable: " + varName);
-                    }
-                    tempString << it->second.second;
-                } else {
-                    tempString << tokens[i].value[j];
-                }
-            }
-        } 
-        else if (tokens[i].type == IDENTIFIER) {
-            auto it = variables.find(tokenValue);
-            if (it == variables.end()) {
-                throw std::runtime_error("Undefined variable: " + tokenValue);
+    std::shared_ptr<Chunk> chunk = Compiler(profiler != nullptr).compileStatement(stmt);
+    VM(*this).run(*chunk);
+    output->endBlock();
+}
+
+void Interpreter::runTree(const Stmt& stmt) {
+    size_t callerBase = treeBase;
+    size_t slotBase = treeSlots.size();
+    Scope callerScope = treeScope;
+    treeBase = treeFrames.size();
+    const Stmt* current = &stmt;
+
+    try {
+        executeStatement(stmt);
+        while (treeFrames.size() > treeBase) {
+            TreeFrame& frame = treeFrames.back();
+            if (frame.next < frame.block->size()) {
+                current = (*frame.block)[frame.next++].get();
+                executeStatement(*current);
+            } else {
+                if (frame.loop) current = frame.loop;
+                finishTreeBlock();
             }
+        }
+    } catch (const ScriptError&) {
+        unwindTree(callerBase, callerScope, slotBase);
+        throw;
+    } catch (const std::exception& e) {
+        int line = current->line;
+        std::string file = treeScope.function ? treeScope.function->file : std::string();
+        unwindTree(callerBase, callerScope, slotBase);
+        throw ScriptError(line, e.what(), std::move(file));
+    } catch (const ExitRequest&) {
+        unwindTree(callerBase, callerScope, slotBase);
+        throw;
+    }
+    treeBase = callerBase;
+}
 
-            const std::string& varType = it->second.first;
-            const std::string& varValue = it->second.second;
-
-            if (insideString) {
-                tempString << varValue;
-            } else if (varType == "number") {
-                double value = std::stod(varValue);
-                if (!mathStarted) {
-                    mathResult = value;
-                    mathStarted = true;
-                } else if (isMathMode) {
-                    switch (currentOperator) {
-                        case '+': mathResult += value; break;
-                        case '-': mathResult -= value; break;
-                        case '*': mathResult *= value; break;
-                        case '^': mathResult = std::pow(mathResult, value); break;
-                        case '/':
-                            if (value == 0) throw std::runtime_error("Division by zero.");
-                            mathResult /= value;
-                            break;
-                    }
-                }
+void Interpreter::executeStatement(const Stmt& stmt) {
+    if (profiler) profiler->line(stmt.line);
+    switch (stmt.kind) {
+        case Stmt::Kind::Send: {
+            const Expr& value = *static_cast<const SendStmt&>(stmt).value;
+            if (value.kind == Expr::Kind::Template) {
+                interpolate(treeScope, static_cast<const TemplateExpr&>(value).parts, output->buffer());
+                output->endLine();
             } else {
-                output << varValue;
+                sendOutput(evaluate(value));
             }
+            break;
+        }
+        case Stmt::Kind::Assign: {
+            const auto& assign = static_cast<const AssignStmt&>(stmt);
+            storeVariable(treeScope, assign.slot, evaluate(*assign.value));
+            break;
+        }
+        case Stmt::Kind::Call:
+            handleFunctionCall(static_cast<const CallStmt&>(stmt));
+            break;
+        case Stmt::Kind::FuncDef: {
+            const auto& def = static_cast<const FuncDefStmt&>(stmt);
+            defineFunction(treeScope, def.slot, def.function);
+            break;
         }
-        else if (tokens[i].type == NUMBER) {
-            double value = std::stod(tokenValue);
-            if (!mathStarted) {
-                mathResult = value;
-                mathStarted = true;
-            } else if (isMathMode) {
-                switch (currentOperator) {
-                    case '+': mathResult += value; break;
-                    case '-': mathResult -= value; break;
-                    case '*': mathResult *= value; break;
-                    case '^': mathResult = std::pow(mathResult, value); break;
-                    case '/':
-                        if (value == 0) throw std::runtime_error("Division by zero.");
-                        mathResult /= value;
-                        break;
+        case Stmt::Kind::If: {
+            const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+            for (const IfBranch& branch : ifStmt.branches) {
+                if (evaluate(*branch.condition).isTruthy()) {
+                    treeFrames.push_back({ &branch.body, 0, nullptr, {}, {}, nullptr, {} });
+                    return;
                 }
             }
-        } 
-        else if (tokens[i].type == OPERATOR && tokenValue == "+") {
-            if (insideString) {
-                tempString << "";
-            } else {
-                currentOperator = tokenValue[0];
-                isMathMode = true;
-            }
+            treeFrames.push_back({ &ifStmt.elseBody, 0, nullptr, {}, {}, nullptr, {} });
+            break;
         }
-        else if (tokens[i].type == OPERATOR) {
-            currentOperator = tokenValue[0];
-            isMathMode = true;
+        case Stmt::Kind::While: {
+            const auto& whileStmt = static_cast<const WhileStmt&>(stmt);
+            if (evaluate(*whileStmt.condition).isTruthy()) {
+                treeFrames.push_back({ &whileStmt.body, 0, &stmt, {}, {}, nullptr, {} });
+            }
+            break;
         }
-        else if (tokenValue == "input") {
-            if (i + 1 >= tokens.size() || tokens[i + 1].type != IDENTIFIER) {
-                throw std::runtime_error("Expected a variable name after 'input'.");
+        case Stmt::Kind::For: {
+            const auto& forStmt = static_cast<const ForStmt&>(stmt);
+            Value start = evaluate(*forStmt.start);
+            Value end = evaluate(*forStmt.end);
+            checkRange(start, end);
+            if (rangeContinues(start, end)) {
+                storeVariable(treeScope, forStmt.slot, start);
+                treeFrames.push_back({ &forStmt.body, 0, &stmt, std::move(start), std::move(end), nullptr, {} });
             }
+            break;
+        }
+        case Stmt::Kind::Run:
+            runFile(static_cast<const RunStmt&>(stmt).path);
+            break;
+        case Stmt::Kind::Import: {
+            const auto& import = static_cast<const ImportStmt&>(stmt);
+            importModule(import.path, import.name);
+            break;
+        }
+        case Stmt::Kind::Exit:
+            handleExit();
+            break;
+    }
+}
 
-            const std::string& varName = tokens[i + 1].value;
-            std::string userInput;
+void Interpreter::finishTreeBlock() {
+    TreeFrame& frame = treeFrames.back();
+    if (frame.loop && frame.loop->kind == Stmt::Kind::While) {
+        if (evaluate(*static_cast<const WhileStmt*>(frame.loop)->condition).isTruthy()) {
+            frame.next = 0;
+            return;
+        }
+    } else if (frame.loop) {
+        frame.counter = nextInRange(frame.counter);
+        if (rangeContinues(frame.counter, frame.end)) {
+            storeVariable(treeScope, static_cast<const ForStmt*>(frame.loop)->slot, frame.counter);
+            frame.next = 0;
+            return;
+        }
+    } else if (frame.function) {
+        treeSlots.resize(treeScope.base);
+        treeScope = frame.caller;
+        --callDepth;
+        if (profiler) profiler->exitFunction();
+        if (pendingMemo.table) finishMemoCall();
+    }
+    treeFrames.pop_back();
+}
 
-            std::getline(std::cin, userInput);
+void Interpreter::handleFunctionCall(const CallStmt& call) {
+    // A call is in tail position when every block of the calling function has
+    // run its last statement and no loop is waiting to repeat. The callee
+    // then takes over the caller's frame instead of nesting inside it.
+    size_t tailFrame = treeFrames.size();
+    for (size_t i = treeFrames.size(); i-- > treeBase;) {
+        const TreeFrame& frame = treeFrames[i];
+        if (frame.loop || frame.next < frame.block->size()) break;
+        if (frame.function) {
+            tailFrame = i;
+            break;
+        }
+    }
 
-            variables[varName] = {"string", userInput};
+    size_t first = treeSlots.size();
+    for (const ExprPtr& arg : call.args) {
+        Value value = evaluate(*arg);
+        treeSlots.push_back(std::move(value));
+    }
 
-            ++i;
-        }
+    const FunctionObject& callee = lookupFunction(treeScope, call.callee, call.args.size());
+    if (callee.native) {
+        std::shared_ptr<const NativeFunction> native = callee.native;
+        callNative(*native, treeSlots.data() + first, call.args.size());
+        treeSlots.resize(first);
+        return;
+    }
+    std::shared_ptr<const FunctionDef> function = callee.definition;
+    // A memoized call always gets its own frame, so its return can be seen.
+    bool memoized = memoizes(callee);
+    if (memoized && beginMemoCall(callee, treeSlots.data() + first, call.args.size())) {
+        treeSlots.resize(first);
+        return;
+    }
 
+    if (tailFrame < treeFrames.size() && !memoized) {
+        size_t base = treeScope.base;
+        std::move(treeSlots.begin() + first, treeSlots.end(), treeSlots.begin() + base);
+        treeSlots.resize(base + call.args.size());
+        treeSlots.resize(base + function->locals.size());
+        treeFrames.resize(tailFrame + 1);
+        if (profiler) {
+            profiler->exitFunction();
+            profiler->enterFunction(function);
+        }
+        TreeFrame& frame = treeFrames.back();
+        frame.block = &function->body;
+        frame.next = 0;
+        treeScope.function = function.get();
+        frame.function = std::move(function);
+        return;
+    }
 
-        else if (tokenValue[0] == '{') {
-            throw std::runtime_error("Invalid use of curly braces '{'.");
-        }
+    if (callDepth >= maxCallDepth) callDepthExceeded(treeTrace());
+    ++callDepth;
+    if (profiler) profiler->enterFunction(function);
+    treeSlots.resize(first + function->locals.size());
+    const Block* body = &function->body;
+    treeFrames.push_back({ body, 0, nullptr, {}, {}, std::move(function), treeScope });
+    treeScope = { treeFrames.back().function.get(), &treeSlots, first };
+}
 
-        if (tokenValue == "#") {
-            break;
+std::vector<Interpreter::TraceEntry> Interpreter::treeTrace() const {
+    std::vector<TraceEntry> trace;
+    int line = 0;
+    for (size_t i = treeFrames.size(); i-- > treeBase;) {
+        const TreeFrame& frame = treeFrames[i];
+        if (line == 0 && frame.next > 0) line = (*frame.block)[frame.next - 1]->line;
+        if (frame.function) {
+            trace.push_back({ frame.function.get(), line });
+            line = 0;
         }
     }
+    return trace;
+}
 
-    if (insideString) {
-        output << tempString.str();
+void Interpreter::unwindTree(size_t callerBase, const Scope& callerScope, size_t slotBase) {
+    for (size_t i = treeBase; i < treeFrames.size(); ++i) {
+        if (!treeFrames[i].function) continue;
+        --callDepth;
+        if (profiler) profiler->exitFunction();
     }
+    treeFrames.resize(treeBase);
+    treeSlots.resize(slotBase);
+    treeScope = callerScope;
+    treeBase = callerBase;
+    pendingMemo = PendingMemo();
+}
 
-    if (mathStarted) {
-        output << mathResult;
+Value Interpreter::evaluate(const Expr& expr) {
+    switch (expr.kind) {
+        case Expr::Kind::Literal:
+            return static_cast<const LiteralExpr&>(expr).value;
+        case Expr::Kind::Template: {
+            std::string text;
+            interpolate(treeScope, static_cast<const TemplateExpr&>(expr).parts, text);
+            return Value::string(std::move(text));
+        }
+        case Expr::Kind::Variable:
+            return loadVariable(treeScope, static_cast<const VariableExpr&>(expr).slot);
+        case Expr::Kind::Input: {
+            const auto& input = static_cast<const InputExpr&>(expr);
+            if (input.target.empty()) {
+                return parseInput(readLine());
+            }
+            storeVariable(treeScope, input.slot, Value::string(readLine()));
+            return Value::string("");
+        }
+        case Expr::Kind::Binary: {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            Value left = evaluate(*binary.left);
+            return applyOperator(binary.op, left, evaluate(*binary.right));
+        }
+        case Expr::Kind::Compare: {
+            const auto& compare = static_cast<const CompareExpr&>(expr);
+            Value left = evaluate(*compare.left);
+            return compareValues(compare.op, left, evaluate(*compare.right));
+        }
+        case Expr::Kind::Array: {
+            std::vector<Value> elements;
+            for (const ExprPtr& element : static_cast<const ArrayExpr&>(expr).elements) {
+                elements.push_back(evaluate(*element));
+            }
+            return makeArray(elements.data(), elements.size());
+        }
+        case Expr::Kind::Index: {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            Value target = evaluate(*index.target);
+            return indexArray(target, evaluate(*index.index));
+        }
+        case Expr::Kind::Builtin: {
+            const auto& call = static_cast<const BuiltinExpr&>(expr);
+            Value args[2];
+            for (size_t i = 0; i < call.args.size(); ++i) {
+                args[i] = evaluate(*call.args[i]);
+            }
+            return callBuiltin(call.builtin, args);
+        }
     }
-
-    return output.str();
+    throw std::runtime_error("Unknown expression.");
 }
 
-double Interpreter::evaluateExpression(const std::string& expr) {
-    std::istringstream exprStream(expr);
-    double result = 0;
-    double currentValue;
-    char op = '+';
+void Interpreter::sendOutput(const Value& value) {
+    value.appendTo(output->buffer());
+    output->endLine();
+}
 
-    while (exprStream >> currentValue) {
-        if (exprStream >> op) {
-            switch (op) {
-                case '+': result += currentValue; break;
-                case '-': result -= currentValue; break;
-                case '*': result *= currentValue; break;
-                case '^': result = std::pow(result, currentValue); break;
-                case '/':
-                    if (currentValue == 0) throw std::runtime_error("Division by zero.");
-                    result /= currentValue;
-                    break;
-                default:
-                    throw std::runtime_error("Invalid operator in expression.");
+// Measures every part first so the text is appended with one reservation and
+// one copy per part. Non-string values are formatted into templateDigits on the
+// way and copied from there in the same order.
+void Interpreter::interpolate(const Scope& scope, const std::vector<TemplatePart>& parts, std::string& out) {
+    templatePieces.clear();
+    templateDigits.clear();
+    size_t size = 0;
+    for (const TemplatePart& part : parts) {
+        TemplatePiece piece;
+        if (!part.isVariable) {
+            piece = { part.text.data(), part.text.size() };
+        } else {
+            const Value& value = loadVariable(scope, part.slot);
+            if (value.isString()) {
+                piece = { value.asString().data(), value.asString().size() };
+            } else {
+                size_t start = templateDigits.size();
+                value.appendTo(templateDigits);
+                piece = { nullptr, templateDigits.size() - start };
             }
+        }
+        size += piece.size;
+        templatePieces.push_back(piece);
+    }
+
+    out.reserve(out.size() + size);
+    const char* digits = templateDigits.data();
+    for (const TemplatePiece& piece : templatePieces) {
+        if (piece.data) {
+            out.append(piece.data, piece.size);
         } else {
-            result = currentValue;
+            out.append(digits, piece.size);
+            digits += piece.size;
         }
     }
-    return result;
 }
 
-double Interpreter::evaluateCondition(const std::string& conditionLine) {
-    std::vector<Token> tokens = tokenize(conditionLine);
-    if (tokens.size() < 3 || tokens[1].type != OPERATOR) {
-        throw std::runtime_error("Invalid condition syntax in: " + conditionLine);
+// Buffered output is flushed first so messages stay in order with it.
+void Interpreter::reportError(const std::string& path, int line, const char* message) {
+    ++errorCount;
+    output->flush();
+    errors->write("Error in line " + std::to_string(line) + " of " + path + ": " + message);
+    errors->endLine();
+}
+
+void Interpreter::defineFunction(const Scope& scope, Slot slot, const std::shared_ptr<const FunctionDef>& function) {
+    Value value = Value::function(function);
+    if (slot.local) {
+        (*scope.slots)[scope.base + slot.index] = std::move(value);
+    } else {
+        globals[slot.index] = std::move(value);
     }
+}
 
-    auto left = tokens[0].value;
-    auto right = tokens[2].value;
-    auto op = tokens[1].value;
+const Value& Interpreter::loadVariable(const Scope& scope, Slot slot) {
+    const Value& value = slot.local ? (*scope.slots)[scope.base + slot.index] : globals[slot.index];
+    if (!value.isDefined()) undefinedVariable(scope, slot);
+    return value;
+}
 
-    if (variables.find(left) != variables.end()) {
-        left = variables[left].second;
-    }
+void Interpreter::undefinedVariable(const Scope& scope, Slot slot) const {
+    throw std::runtime_error("Undefined variable: " + slotName(scope, slot));
+}
 
-    if (variables.find(right) != variables.end()) {
-        right = variables[right].second;
+void Interpreter::storeVariable(const Scope& scope, Slot slot, Value value) {
+    if (slot.local) {
+        (*scope.slots)[scope.base + slot.index] = std::move(value);
+    } else {
+        globals[slot.index] = std::move(value);
     }
+}
 
-    double leftValue = std::stod(left);
-    double rightValue = std::stod(right);
+const FunctionObject& Interpreter::lookupFunction(const Scope& scope, Slot slot, size_t argCount) {
+    const Value& value = slot.local ? (*scope.slots)[scope.base + slot.index] : globals[slot.index];
+    if (!value.isDefined()) {
+        throw std::runtime_error("Undefined function: " + slotName(scope, slot));
+    }
+    if (!value.isFunction()) {
+        throw std::runtime_error("'" + slotName(scope, slot) + "' is a " + value.typeName() + ", not a function.");
+    }
 
-    if (op == "==") return leftValue == rightValue;
-    if (op == "!=") return leftValue != rightValue;
-    if (op == "<") return leftValue < rightValue;
-    if (op == ">") return leftValue > rightValue;
-    if (op == "<=") return leftValue <= rightValue;
-    if (op == ">=") return leftValue >= rightValue;
+    const FunctionObject& function = value.asFunction();
+    size_t paramCount = function.native ? function.native->params.size() : function.definition->params.size();
+    if (argCount != paramCount) {
+        throw std::runtime_error("Function '" + slotName(scope, slot) + "' expects " +
+                                 std::to_string(paramCount) + " arguments, but " +
+                                 std::to_string(argCount) + " were provided.");
+    }
+    return function;
+}
 
-    throw std::runtime_error("Unsupported operator in condition: " + op);
+void Interpreter::callNative(const NativeFunction& function, const Value* args, size_t count) {
+    static const char* const expected[] = { "a value", "a number", "an integer", "a string", "a boolean", "an array" };
+    for (size_t i = 0; i < count; ++i) {
+        const Value& arg = args[i];
+        bool matches;
+        switch (function.params[i]) {
+            case NativeType::Any: matches = arg.isDefined(); break;
+            case NativeType::Number: matches = arg.isNumber(); break;
+            case NativeType::Integer: matches = arg.isInteger(); break;
+            case NativeType::String: matches = arg.isString(); break;
+            case NativeType::Boolean: matches = arg.isBoolean(); break;
+            default: matches = arg.isArray(); break;
+        }
+        if (!matches) {
+            throw std::runtime_error("Argument " + std::to_string(i + 1) + " of '" + function.name + "' must be " +
+                                     expected[static_cast<int>(function.params[i])] + " (got " + arg.typeName() + ").");
+        }
+    }
+    NativeCall call(*this, args, count);
+    function.body(call);
 }
 
-void Interpreter::handleFunctionCall(const std::vector<Token>& tokens) {
-    const std::string& funcName = tokens[0].value;
+bool Interpreter::beginMemoCall(const FunctionObject& callee, const Value* args, size_t count) {
+    if (!callee.memo) callee.memo = std::make_shared<MemoTable>(memoCapacity);
+    // The globals the function reads are keyed like extra arguments.
+    const std::vector<uint32_t>& inputs = callee.definition->inputs;
+    if (!inputs.empty()) {
+        memoKey.assign(args, args + count);
+        for (uint32_t slot : inputs) {
+            memoKey.push_back(globals[slot]);
+        }
+        args = memoKey.data();
+        count = memoKey.size();
+    }
+    if (const std::vector<Value>* outputs = callee.memo->find(args, count)) {
+        const std::vector<uint32_t>& slots = callee.definition->outputs;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            globals[slots[i]] = (*outputs)[i];
+        }
+        ++memoStats.hits;
+        return true;
+    }
+    ++memoStats.misses;
+    if (!callee.memo->isEnabled()) return false;
+    pendingMemo.table = callee.memo;
+    pendingMemo.function = callee.definition;
+    pendingMemo.args.assign(args, args + count);
+    return false;
+}
 
-    if (functions.find(funcName) == functions.end()) {
-        throw std::runtime_error("Undefined function: " + funcName);
+void Interpreter::finishMemoCall() {
+    std::vector<Value> outputs;
+    outputs.reserve(pendingMemo.function->outputs.size());
+    for (uint32_t slot : pendingMemo.function->outputs) {
+        outputs.push_back(globals[slot]);
     }
+    pendingMemo.table->insert(std::move(pendingMemo.args), std::move(outputs));
+    pendingMemo = PendingMemo();
+}
 
-    const auto& func = functions[funcName];
-    const auto& paramNames = func.first;
-    const auto& funcBody = func.second;
+const std::string& Interpreter::slotName(const Scope& scope, Slot slot) const {
+    return slot.local ? scope.function->locals[slot.index] : symbols.name(slot.index);
+}
 
-    std::vector<std::string> args;
-    for (size_t i = 1; i < tokens.size(); ++i) {
-        if (tokens[i].type == IDENTIFIER || tokens[i].type == NUMBER || tokens[i].type == STRING_LITERAL) {
-            args.push_back(tokens[i].value);
-        } else if (tokens[i].type == OPERATOR && tokens[i].value == ",") {
-            continue;
-        } else {
-            throw std::runtime_error("Invalid syntax in function call.");
-        }
+void Interpreter::callDepthExceeded(const std::vector<TraceEntry>& trace) const {
+    std::string message = "Maximum call depth of " + std::to_string(maxCallDepth) + " exceeded. Call stack, innermost first:";
+
+    // Runs of the same call site are folded into one line, and only the ends
+    // of a long stack are shown.
+    std::vector<std::string> lines;
+    for (size_t i = 0; i < trace.size();) {
+        size_t repeats = 1;
+        while (i + repeats < trace.size() && trace[i + repeats].function == trace[i].function &&
+               trace[i + repeats].line == trace[i].line) {
+            ++repeats;
+        }
+        const FunctionDef& function = *trace[i].function;
+        std::string line = "\n  at " + function.name + " (" + (function.file.empty() ? "line " : function.file + ":") +
+                           std::to_string(trace[i].line) + ")";
+        if (repeats > 1) line += " x" + std::to_string(repeats);
+        lines.push_back(std::move(line));
+        i += repeats;
     }
 
-    if (args.size() != paramNames.size()) {
-        throw std::runtime_error("Function '" + funcName + "' expects " +
-                                 std::to_string(paramNames.size()) + " arguments, but " +
-                                 std::to_string(args.size()) + " were provided.");
+    const size_t shown = 10;
+    for (size_t i = 0; i < lines.size(); ++i) {
+        if (lines.size() > 2 * shown && i == shown) {
+            message += "\n  ... " + std::to_string(lines.size() - 2 * shown) + " more";
+            i = lines.size() - shown;
+        }
+        message += lines[i];
     }
+    throw std::runtime_error(message);
+}
 
-    auto globalVars = variables;
-    std::unordered_map<std::string, std::pair<std::string, std::string>> localVars = variables;
+std::string Interpreter::readLine() {
+    // Flushed so a prompt sent just before the read is visible.
+    output->flush();
+    std::string line;
+    input.readLine(line);
+    return line;
+}
 
-    for (size_t i = 0; i < paramNames.size(); ++i) {
-        const std::string& argValue = args[i];
+void Interpreter::handleExit() {
+    output->flush();
+    throw ExitRequest();
+}
 
-        if (variables.find(argValue) != variables.end()) {
-            localVars[paramNames[i]] = variables[argValue];
-        } else if (std::all_of(argValue.begin(), argValue.end(), ::isdigit) ||
-                   (argValue[0] == '-' && argValue.size() > 1 && std::isdigit(argValue[1]))) {
-            localVars[paramNames[i]] = { "number", argValue };
-        } else {
-            localVars[paramNames[i]] = { "string", argValue };
-        }
+Value Interpreter::applyOperator(char op, const Value& left, const Value& right) {
+    if (left.isInteger() && right.isInteger()) {
+        return applyIntegerOperator(op, left.asInteger(), right.asInteger());
+    }
+    if (left.isNumber() && right.isNumber()) {
+        if (!left.isFloat() && !right.isFloat()) return applyBigIntOperator(op, left.toBigInt(), right.toBigInt());
+        double mathResult = left.asNumber();
+        double value = right.asNumber();
+        switch (op) {
+            case '+': mathResult += value; break;
+            case '-': mathResult -= value; break;
+            case '*': mathResult *= value; break;
+            case '^': mathResult = std::pow(mathResult, value); break;
+            case '/':
+                if (value == 0) throw std::runtime_error("Division by zero.");
+                mathResult /= value;
+                break;
+        }
+        return Value::number(mathResult);
     }
 
-    variables = localVars;
-    for (const auto& line : funcBody) {
-        execute(line);
+    if ((left.isArray() || right.isArray()) && !left.isString() && !right.isString()) {
+        return applyArrayOperator(op, left, right);
     }
 
-    variables = globalVars;
+    if (op == '+' && (left.isString() || right.isString())) {
+        return Value::concatenate(left, right);
+    }
+    throw std::runtime_error(std::string("Invalid operands for '") + op + "': " +
+                             left.typeName() + " and " + right.typeName() + ".");
 }
 
-int Interpreter::getIndentationLevel(const std::string& line) {
-    int level = 0;
-    for (char c : line) {
-        if (c == ' ') level++;
-        else if (c == '\t') level += 4;
-        else break;
+// Integers stay exact: results that overflow int64 continue as BigInts, and
+// only a division with a remainder or a negative exponent gives a Float.
+Value Interpreter::applyIntegerOperator(char op, int64_t left, int64_t right) {
+    int64_t result;
+    switch (op) {
+        case '+':
+            if (checkedAdd(left, right, result)) return Value::integer(result);
+            break;
+        case '-':
+            if (checkedSubtract(left, right, result)) return Value::integer(result);
+            break;
+        case '*':
+            if (checkedMultiply(left, right, result)) return Value::integer(result);
+            break;
+        case '^':
+            if (right < 0) return Value::number(std::pow(static_cast<double>(left), static_cast<double>(right)));
+            if (checkedPower(left, right, result)) return Value::integer(result);
+            break;
+        case '/':
+            if (right == 0) throw std::runtime_error("Division by zero.");
+            // INT64_MIN / -1 overflows, and so does INT64_MIN % -1.
+            if (right == -1) {
+                if (checkedSubtract(0, left, result)) return Value::integer(result);
+                break;
+            }
+            if (left % right == 0) return Value::integer(left / right);
+            return Value::number(static_cast<double>(left) / static_cast<double>(right));
     }
-    return level;
+    return applyBigIntOperator(op, BigInt(left), BigInt(right));
 }
 
-std::string Interpreter::trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t");
-    size_t last = str.find_last_not_of(" \t");
-    return (first == std::string::npos) ? "" : str.substr(first, last - first + 1);
+Value Interpreter::applyBigIntOperator(char op, const BigInt& left, const BigInt& right) {
+    switch (op) {
+        case '+': return Value::bigInt(BigInt::add(left, right));
+        case '-': return Value::bigInt(BigInt::subtract(left, right));
+        case '*': return Value::bigInt(BigInt::multiply(left, right));
+        case '/': {
+            if (right.isZero()) throw std::runtime_error("Division by zero.");
+            BigInt quotient;
+            if (BigInt::divideExact(left, right, quotient)) return Value::bigInt(std::move(quotient));
+            return Value::number(left.toDouble() / right.toDouble());
+        }
+        default:
+            if (!right.isNegative() && right.fitsInt64() &&
+                static_cast<uint64_t>(right.toInt64()) <= maxPowerBits / std::max<size_t>(left.bitLength(), 1)) {
+                return Value::bigInt(BigInt::power(left, static_cast<uint64_t>(right.toInt64())));
+            }
+            return Value::number(std::pow(left.toDouble(), right.toDouble()));
+    }
 }
 
-std::vector<Token> Interpreter::tokenize(const std::string& line) {
-    std::vector<Token> tokens;
-    size_t i = 0;
+Value Interpreter::compareValues(CompareOp op, const Value& left, const Value& right) {
+    bool result;
+    if (left.isInteger() && right.isInteger()) {
+        result = compareOrdered(op, left.asInteger(), right.asInteger());
+    } else if (left.isNumber() && right.isNumber()) {
+        // NaN is unordered: only != holds.
+        int order;
+        result = Value::compareNumbers(left, right, order) ? compareOrdered(op, order, 0) : op == CompareOp::NotEqual;
+    } else if (op == CompareOp::Equal) {
+        result = left.equals(right);
+    } else if (op == CompareOp::NotEqual) {
+        result = !left.equals(right);
+    } else {
+        throw std::runtime_error(std::string("Only numbers can be ordered, got ") + left.typeName() +
+                                 " and " + right.typeName() + ".");
+    }
+    return Value::boolean(result);
+}
 
-    while (i < line.length()) {
-        if (std::isspace(line[i])) {
-            i++;
-            continue;
-        }
+// Arrays combine element by element with arrays of the same size, or with a
+// number applied to every element.
+Value Interpreter::applyArrayOperator(char op, const Value& left, const Value& right) {
+    if ((!left.isArray() && !left.isNumber()) || (!right.isArray() && !right.isNumber())) {
+        throw std::runtime_error(std::string("Invalid operands for '") + op + "': " +
+                                 left.typeName() + " and " + right.typeName() + ".");
+    }
+    double leftNumber = left.isNumber() ? left.asNumber() : 0;
+    double rightNumber = right.isNumber() ? right.asNumber() : 0;
+    const double* leftData = left.isArray() ? left.asArray().data() : &leftNumber;
+    const double* rightData = right.isArray() ? right.asArray().data() : &rightNumber;
+    size_t size = left.isArray() ? left.asArray().size() : right.asArray().size();
+    if (left.isArray() && right.isArray() && right.asArray().size() != size) {
+        throw std::runtime_error("Array sizes differ: " + std::to_string(size) + " and " +
+                                 std::to_string(right.asArray().size()) + ".");
+    }
+    const double* rightEnd = rightData + (right.isArray() ? size : 1);
+    if (op == '/' && std::find(rightData, rightEnd, 0.0) != rightEnd) {
+        throw std::runtime_error("Division by zero.");
+    }
 
-        if (line[i] == '#') {
-            if (!tokens.empty() && tokens.back().type == SEND) {
-                tokens.push_back({ STRING_LITERAL, "#" });
-                i++;
-                continue;
-            }
-            tokens.push_back({ COMMENT, line.substr(i) });
-            break;
+    std::vector<double> result(size);
+    arrayArithmetic(op, leftData, !left.isArray(), rightData, !right.isArray(), result.data(), size);
+    return Value::array(std::move(result));
+}
+
+Value Interpreter::makeArray(const Value* elements, size_t count) {
+    std::vector<double> numbers(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (!elements[i].isNumber()) {
+            throw std::runtime_error(std::string("Array elements must be numbers, got ") + elements[i].typeName() + ".");
         }
-        else if (line[i] == ',') {
-            tokens.push_back({ OPERATOR, "," });
-            i++;
-            continue;
+        numbers[i] = elements[i].asNumber();
+    }
+    return Value::array(std::move(numbers));
+}
+
+Value Interpreter::indexArray(const Value& target, const Value& index) {
+    if (!target.isArray()) {
+        throw std::runtime_error(std::string("Only arrays can be indexed, got ") + target.typeName() + ".");
+    }
+    if (!index.isNumber()) {
+        throw std::runtime_error(std::string("Array index must be a number, got ") + index.typeName() + ".");
+    }
+    const std::vector<double>& elements = target.asArray();
+    double position = index.asNumber();
+    if (!(position >= 0 && position < static_cast<double>(elements.size())) || position != std::floor(position)) {
+        throw std::runtime_error("Array index " + index.toString() + " is out of range for " +
+                                 std::to_string(elements.size()) + " elements.");
+    }
+    return Value::number(elements[static_cast<size_t>(position)]);
+}
+
+Value Interpreter::callBuiltin(Builtin builtin, const Value* args) {
+    const char* name = builtinName(builtin);
+    if (builtin == Builtin::Len) {
+        if (args[0].isArray()) return Value::integer(static_cast<int64_t>(args[0].asArray().size()));
+        if (args[0].isString()) return Value::integer(static_cast<int64_t>(args[0].stringLength()));
+        throw std::runtime_error(std::string("len expects an array or a string, got ") + args[0].typeName() + ".");
+    }
+    for (size_t i = 0; i < builtinArity(builtin); ++i) {
+        if (!args[i].isArray()) {
+            throw std::runtime_error(std::string(name) + " expects an array, got " + args[i].typeName() + ".");
         }
-        else if (line.substr(i, 4) == "send") {
-            size_t nextCharPos = i + 4;
-            if (nextCharPos >= line.length() || !std::isspace(line[nextCharPos])) {
-                throw std::runtime_error("Invalid syntax: 'send' must be followed by a space.");
-            }
-            tokens.push_back({ SEND, "send" });
-            i += 4;
-        }
-        else if (line.substr(i, 4) == "func") {
-            tokens.push_back({ FUNC, "func" });
-            i += 4;
-            continue;
-        }
-        else if (line.substr(i, 3) == "run") {
-            tokens.push_back({ RUN, "run" });
-            i += 3;
-            while (i < line.length() && std::isspace(line[i])) i++;
-            size_t pathStart = i;
-            while (i < line.length() && !std::isspace(line[i])) i++;
-            tokens.push_back({ STRING_LITERAL, line.substr(pathStart, i - pathStart) });
-        }
-        else if (line.substr(i, 8) == "variable") {
-            tokens.push_back({ VARIABLE, "variable" });
-            i += 8;
-        }
-        else if (line.substr(i, 4) == "exit") {
-            tokens.push_back({ EXIT, "exit" });
-            i += 4;
-        }
-        else if (line[i] == '"') {
-            std::string literal;
-            i++;
-            while (i < line.length() && line[i] != '"') {
-                if (line[i] == '\\' && i + 1 < line.length()) {
-                    switch (line[i + 1]) {
-                        case 'n': literal += '\n'; break;
-                        case 't': literal += '\t'; break;
-                        case '\\': literal += '\\'; break;
-                        case '"': literal += '"'; break;
-                        default: literal += line[i + 1]; break;
-                    }
-                    i++;
-                } else {
-                    literal += line[i];
-                }
-                i++;
-            }
-            if (i >= line.length() || line[i] != '"') {
-                throw std::runtime_error("Unterminated string literal");
-            }
-            tokens.push_back({ STRING_LITERAL, literal });
-            i++;
-        }
-        else if (line[i] == '-' && (i == 0 || tokens.back().type == OPERATOR || tokens.back().type == ASSIGNMENT || tokens.back().type == SEND)) {
-            size_t start = i++;
-            while (i < line.length() && (std::isdigit(line[i]) || line[i] == '.')) i++;
-            if (start + 1 == i) {
-                tokens.push_back({ OPERATOR, "-" });
-            } else {
-                tokens.push_back({ NUMBER, line.substr(start, i - start) });
+    }
+
+    const std::vector<double>& values = args[0].asArray();
+    switch (builtin) {
+        case Builtin::Sum:
+            return Value::number(arraySum(values.data(), values.size()));
+        case Builtin::Min:
+        case Builtin::Max:
+            if (values.empty()) throw std::runtime_error(std::string(name) + " of an empty array.");
+            return Value::number(builtin == Builtin::Min ? arrayMin(values.data(), values.size())
+                                                         : arrayMax(values.data(), values.size()));
+        default: {
+            const std::vector<double>& other = args[1].asArray();
+            if (other.size() != values.size()) {
+                throw std::runtime_error("Array sizes differ: " + std::to_string(values.size()) + " and " +
+                                         std::to_string(other.size()) + ".");
             }
-        }
-        else if (std::isdigit(line[i])) {
-            size_t start = i;
-            while (i < line.length() && (std::isdigit(line[i]) || line[i] == '.')) i++;
-            tokens.push_back({ NUMBER, line.substr(start, i - start) });
-        }
-        else if (std::isalpha(line[i]) || line[i] == '_') {
-            size_t start = i;
-            while (i < line.length() && (std::isalnum(line[i]) || line[i] == '_')) i++;
-            tokens.push_back({ IDENTIFIER, line.substr(start, i - start) });
-        }
-        else if (line[i] == '=' || line[i] == '+' || line[i] == '-' || line[i] == '*' || line[i] == '^' || line[i] == '/') {
-            tokens.push_back({ line[i] == '=' ? ASSIGNMENT : OPERATOR, std::string(1, line[i]) });
-            i++;
-        } else {
-            throw std::runtime_error("Invalid token at: " + std::string(1, line[i]));
+            return Value::number(arrayDot(values.data(), other.data(), values.size()));
         }
     }
+}
 
-    return tokens;
-}
\ No newline at end of file
+void Interpreter::checkRange(const Value& start, const Value& end) {
+    if (!start.isNumber() || !end.isNumber()) {
+        throw std::runtime_error(std::string("Range bounds must be numbers, got ") + start.typeName() + " and " +
+                                 end.typeName() + ".");
+    }
+}
+
+// Typed like the original interpreter: true/false, then digits and dots, then
+// text. Digits alone are an integer.
+Value Interpreter::parseInput(const std::string& text) {
+    if (text == "true" || text == "false") {
+        return Value::boolean(text == "true");
+    }
+    if (!text.empty() && std::all_of(text.begin(), text.end(), [](char c) { return std::isdigit(c) || c == '.'; })) {
+        Value integer;
+        if (text.find('.') == std::string::npos && parseInteger(text, integer)) return integer;
+        char* end = nullptr;
+        double value = std::strtod(text.c_str(), &end);
+        if (*end == '\0') return Value::number(value);
+    }
+    return Value::string(text);
+}
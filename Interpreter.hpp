@@ -1,29 +1,298 @@
 #ifndef INTERPRETER_HPP
 #define INTERPRETER_HPP
 
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <unordered_map>
-#include "Token.hpp"
+#include "Ast.hpp"
+#include "Bytecode.hpp"
+#include "LineReader.hpp"
+#include "Memo.hpp"
+#include "Native.hpp"
+#include "OutputSink.hpp"
+#include "ProgramCache.hpp"
+#include "Profiler.hpp"
+#include "SymbolTable.hpp"
 
+// An Interpreter owns all of its state: symbols, globals, engine stacks,
+// partially entered REPL blocks and its output buffer. Separate instances may
+// run concurrently on separate threads; one instance must not be used by two
+// threads at once. Instances still share the standard streams, so concurrent
+// ones should each get their own OutputSink and not read `input` together.
 class Interpreter {
 public:
+    // Tree walks the parsed program directly; VM compiles it to bytecode first.
+    enum class Engine { Tree, VM };
+
     void execute(const std::string& line);
-    std::vector<Token> tokenize(const std::string& line);
-    std::string handleSendCommand(const std::vector<Token>& tokens);
     void handleRunCommand(const std::string& filePath);
-    void handleVariableDeclaration(const std::vector<Token>& tokens);
+    // Runs source text that did not come from a file, such as a script piped
+    // to standard input. `name` is used in error messages.
+    void executeSource(std::string_view source, const std::string& name);
+
+    // Reads the next line of the input that `input` reads from. Returns false
+    // at the end of the input. Hosts reading the same stream must use this,
+    // since the interpreter reads ahead.
+    bool readInputLine(std::string& line) { return input.readLine(line); }
+
+    // Assigns a global variable before any script runs, e.g. script arguments.
+    void setGlobal(const std::string& name, Value value);
+    // The value of a global variable; undefined if it was never assigned.
+    Value getGlobal(const std::string& name) const;
+
+    // A resolved global, for hosts that set the same variable often, such as
+    // a native function returning its result.
+    struct GlobalSlot {
+        uint32_t index;
+    };
+    GlobalSlot globalSlot(const std::string& name);
+    void setGlobal(GlobalSlot slot, Value value) { globals[slot.index] = std::move(value); }
+
+    // Makes `body` callable from scripts as `name`, exactly like a `func` of
+    // that name: calls must pass one argument of each type in `params`.
+    void defineNative(const std::string& name, std::vector<NativeType> params, std::function<void(NativeCall&)> body);
+    // Saves every global and the set of imported modules to `path`, so another
+    // process can start from this state instead of running the same prelude.
+    // Native functions are left out; hosts define them again. Throws
+    // std::runtime_error if the file cannot be written.
+    void saveSnapshot(const std::string& path) const;
+    // Restores a state written by saveSnapshot(), replacing the globals it
+    // saved. Throws std::runtime_error if the file is missing, corrupt or was
+    // written by another build.
+    void loadSnapshot(const std::string& path);
+    // Sets `argCount` and `arg1`..`argN`, converting each argument the way
+    // `input` converts what it reads.
+    void setScriptArguments(const std::vector<std::string>& arguments);
+
+    // Set once a script runs `exit`. Execution stops and the call that was
+    // running returns normally; ending the process is up to the host.
+    bool isExitRequested() const { return exitRequested; }
+
+    void setEngine(Engine engine) { this->engine = engine; }
+    Engine getEngine() const { return engine; }
+
+    // Calls nested deeper than this fail with an error that shows the call
+    // stack. Neither engine recurses natively for script calls, and calls in
+    // tail position replace the caller's frame, so they do not count.
+    void setMaxCallDepth(size_t depth) { maxCallDepth = depth; }
+    size_t getMaxCallDepth() const { return maxCallDepth; }
+
+    // Files larger than this many bytes are parsed and run one chunk of
+    // top-level statements at a time, so the AST never holds the whole file.
+    void setParseBudget(size_t bytes) { parseBudget = bytes; }
+    size_t getParseBudget() const { return parseBudget; }
+
+    // Files run with `run` keep a parsed copy in a `.synzec` cache, next to
+    // the source unless a cache directory is set.
+    void setCacheEnabled(bool enabled) { cacheEnabled = enabled; }
+    bool isCacheEnabled() const { return cacheEnabled; }
+    void setCacheDirectory(std::string directory) { programCache.setDirectory(std::move(directory)); }
+    const std::string& getCacheDirectory() const { return programCache.getDirectory(); }
+
+    // `send` writes to standard output and errors go to standard error unless
+    // other sinks are set; `input` reads standard input unless another stream
+    // is set. Replacements must outlive their use by the interpreter.
+    void setOutputSink(OutputSink& sink) { output = &sink; }
+    OutputSink& getOutputSink() { return *output; }
+    void setErrorSink(OutputSink& sink) { errors = &sink; }
+    void setInputStream(std::istream& stream) { input.reset(stream); }
+    void flushOutput() { output->flush(); }
+
+    // Programs are optimized at this level (see Optimizer) before they run.
+    // With dumping on, each optimized program is also written to the error sink.
+    void setOptimizationLevel(int level) { optimizationLevel = level; }
+    int getOptimizationLevel() const { return optimizationLevel; }
+    void setDumpPrograms(bool dump) { dumpPrograms = dump; }
+
+    // Statements, calls and files are reported to the profiler while one is
+    // set. Set it before running code: function bytecode compiled earlier
+    // carries no line events.
+    void setProfiler(Profiler* profiler) { this->profiler = profiler; }
+
+    // Calls of pure functions (see Purity.hpp) are cached, keeping up to this
+    // many argument lists per function. Zero turns caching off.
+    void setMemoCapacity(size_t entries) { memoCapacity = entries; }
+    size_t getMemoCapacity() const { return memoCapacity; }
+
+    // Calls of pure functions answered from the cache and run in full.
+    struct MemoStats {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+    const MemoStats& getMemoStats() const { return memoStats; }
+
+    // Errors reported while running files, counted over the instance's lifetime.
+    size_t getErrorCount() const { return errorCount; }
+
+    // Whether finishing a file prints how long it took. On by default.
+    void setRunSummaries(bool enabled) { runSummaries = enabled; }
+
+    // When the first top-level statement started, or the epoch if none has run.
+    std::chrono::steady_clock::time_point getFirstStatementTime() const { return firstStatementTime; }
 
 private:
-    std::unordered_map<std::string, std::pair<std::vector<std::string>, std::vector<std::string>>> functions;
-    std::unordered_map<std::string, std::pair<std::string, std::string>> variables;
+    friend class VM;
+    friend class Optimizer;
+
+    // Thrown by `exit` and caught by the public entry points. Deliberately not
+    // a std::exception, so error handlers let it pass.
+    struct ExitRequest {};
+
+    // The locals visible to the running code: a function's slots, stored at
+    // `base` in an engine-owned value stack. Top-level code has no function.
+    struct Scope {
+        const FunctionDef* function = nullptr;
+        std::vector<Value>* slots = nullptr;
+        size_t base = 0;
+    };
+
+    Engine engine = Engine::VM;
+    // Globals are indexed by symbol id. Functions live here too, as function values.
+    SymbolTable symbols;
+    std::vector<Value> globals;
+    size_t maxCallDepth = 100000;
+    size_t parseBudget = 64 * 1024 * 1024;
+    bool cacheEnabled = true;
+    ProgramCache programCache;
+    int optimizationLevel = 1;
+    bool dumpPrograms = false;
+    StreamSink standardOutput{ std::cout };
+    StreamSink standardError{ std::cerr };
+    OutputSink* output = &standardOutput;
+    OutputSink* errors = &standardError;
+    LineReader input{ std::cin };
+    size_t errorCount = 0;
+    bool runSummaries = true;
+    std::chrono::steady_clock::time_point firstStatementTime;
+    Profiler* profiler = nullptr;
+    size_t callDepth = 0;
+    size_t memoCapacity = 1024;
+    MemoStats memoStats;
+
+    // The pure call being run to fill its cache entry. A pure function makes
+    // no calls, so the next function to return is this one.
+    struct PendingMemo {
+        std::shared_ptr<MemoTable> table;
+        std::shared_ptr<const FunctionDef> function;
+        std::vector<Value> args;
+    };
+    PendingMemo pendingMemo;
+    // Scratch space for the key of a function that reads globals.
+    std::vector<Value> memoKey;
+
+    // Files loaded by `import`, by path, with the names they were loaded
+    // under. A module is loaded again only if the file changed since, or under
+    // a new name.
+    struct Module {
+        std::filesystem::file_time_type modified;
+        std::vector<std::string> names;
+    };
+    std::unordered_map<std::string, Module> modules;
+    // The namespace of the module being loaded, if any.
+    std::string currentModule;
+
+    // One entry per block the tree engine is running. Blocks and calls push
+    // entries instead of recursing on the native stack.
+    struct TreeFrame {
+        const Block* block;
+        size_t next;
+        // The while or for statement that repeats this block, if any.
+        const Stmt* loop;
+        Value counter;
+        Value end;
+        // Set on a function body, with the scope to restore when it returns.
+        std::shared_ptr<const FunctionDef> function;
+        Scope caller;
+    };
+
+    // A call that is still running and the line it is at, for stack traces.
+    struct TraceEntry {
+        const FunctionDef* function;
+        int line;
+    };
+
+    Scope treeScope;
+    std::vector<Value> treeSlots;
+    std::vector<TreeFrame> treeFrames;
+    // Frames below this belong to a file that is running the current one.
+    size_t treeBase = 0;
+
+    // Scratch space for interpolate(), kept to avoid allocating per string.
+    struct TemplatePiece {
+        const char* data;  // null for text formatted into templateDigits
+        size_t size;
+    };
+    std::vector<TemplatePiece> templatePieces;
+    std::string templateDigits;
+
+    // REPL lines of a function, if/else or loop block still being entered.
+    std::string pendingSource;
+    bool capturingBlock = false;
+    bool exitRequested = false;
+
+    void executeLine(const std::string& line);
+    void runFile(const std::string& filePath);
+    void importModule(const std::string& filePath, const std::string& name);
+    void runSource(std::string_view source, const std::string& path, bool cacheable);
+
+    Program parseProgram(std::string_view source, const std::string& file = std::string(), int firstLine = 1);
+    Program loadProgram(const std::string& path, std::string_view source);
+    void resolveProgram(Program& program, const std::string& file);
+    void executeTopLevel(const Stmt& stmt);
+
+    void runTree(const Stmt& stmt);
+    void executeStatement(const Stmt& stmt);
+    void finishTreeBlock();
+    void handleFunctionCall(const CallStmt& call);
+    std::vector<TraceEntry> treeTrace() const;
+    void unwindTree(size_t callerBase, const Scope& callerScope, size_t slotBase);
+    Value evaluate(const Expr& expr);
 
-    void handleFunctionCall(const std::vector<Token>& tokens);
-    int getIndentationLevel(const std::string& line);
-    std::string trim(const std::string& str);
+    void sendOutput(const Value& value);
+    void interpolate(const Scope& scope, const std::vector<TemplatePart>& parts, std::string& out);
+    void reportError(const std::string& path, int line, const char* message);
+    void defineFunction(const Scope& scope, Slot slot, const std::shared_ptr<const FunctionDef>& function);
+    const Value& loadVariable(const Scope& scope, Slot slot);
+    [[noreturn]] void undefinedVariable(const Scope& scope, Slot slot) const;
+    void storeVariable(const Scope& scope, Slot slot, Value value);
+    const FunctionObject& lookupFunction(const Scope& scope, Slot slot, size_t argCount);
+    bool memoizes(const FunctionObject& callee) const {
+        return memoCapacity > 0 && callee.definition && callee.definition->pure &&
+               (!callee.memo || callee.memo->isEnabled());
+    }
+    void callNative(const NativeFunction& function, const Value* args, size_t count);
+    // Applies the cached effect of calling `callee` with these arguments and
+    // returns true, or returns false and starts recording the call.
+    bool beginMemoCall(const FunctionObject& callee, const Value* args, size_t count);
+    void finishMemoCall();
+    const std::string& slotName(const Scope& scope, Slot slot) const;
+    [[noreturn]] void callDepthExceeded(const std::vector<TraceEntry>& trace) const;
+    std::string readLine();
+    void handleExit();
 
-    double evaluateExpression(const std::string& expr);
-    double evaluateCondition(const std::string& conditionLine);
+    static Value applyOperator(char op, const Value& left, const Value& right);
+    static Value applyIntegerOperator(char op, int64_t left, int64_t right);
+    static Value applyBigIntOperator(char op, const BigInt& left, const BigInt& right);
+    static Value compareValues(CompareOp op, const Value& left, const Value& right);
+    static void checkRange(const Value& start, const Value& end);
+    static bool rangeContinues(const Value& counter, const Value& end) {
+        if (counter.isInteger() && end.isInteger()) return counter.asInteger() < end.asInteger();
+        return compareValues(CompareOp::Less, counter, end).asBoolean();
+    }
+    static Value nextInRange(const Value& counter) {
+        if (counter.isInteger() && counter.asInteger() < INT64_MAX) return Value::integer(counter.asInteger() + 1);
+        return applyOperator('+', counter, Value::integer(1));
+    }
+    static Value applyArrayOperator(char op, const Value& left, const Value& right);
+    static Value makeArray(const Value* elements, size_t count);
+    static Value indexArray(const Value& target, const Value& index);
+    static Value callBuiltin(Builtin builtin, const Value* args);
+    static Value parseInput(const std::string& text);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,221 @@
+#include "Lexer.hpp"
+#include "ScriptError.hpp"
+#include "Simd.hpp"
+#include <array>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace {
+
+struct Keyword {
+    std::string_view text;
+    TokenType type;
+};
+
+constexpr Keyword keywords[] = {
+    { "send", SEND }, { "func", FUNC }, { "run", RUN }, { "variable", VARIABLE },
+    { "exit", EXIT }, { "if", IF }, { "else", ELSE }, { "while", WHILE }, { "for", FOR }, { "in", IN },
+    { "import", IMPORT }, { "pure", PURE },
+};
+
+// Length, first and last character give every keyword its own bucket, so a
+// lookup is one hash and at most one comparison.
+constexpr size_t keywordHash(const char* text, size_t length) {
+    return (length * 4 + static_cast<unsigned char>(text[0]) + static_cast<unsigned char>(text[length - 1])) & 31;
+}
+
+constexpr std::array<Keyword, 32> buildKeywordTable() {
+    std::array<Keyword, 32> table{};
+    for (const Keyword& keyword : keywords) {
+        table[keywordHash(keyword.text.data(), keyword.text.size())] = keyword;
+    }
+    return table;
+}
+
+constexpr std::array<Keyword, 32> keywordTable = buildKeywordTable();
+
+constexpr bool keywordHashIsPerfect() {
+    for (const Keyword& keyword : keywords) {
+        if (keywordTable[keywordHash(keyword.text.data(), keyword.text.size())].text != keyword.text) return false;
+    }
+    return true;
+}
+
+static_assert(keywordHashIsPerfect(), "keyword hash has collisions");
+
+TokenType keywordType(const char* text, size_t length) {
+    const Keyword& keyword = keywordTable[keywordHash(text, length)];
+    if (keyword.text.size() == length && std::memcmp(keyword.text.data(), text, length) == 0) {
+        return keyword.type;
+    }
+    return IDENTIFIER;
+}
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isIdentifierStart(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+}
+
+class Lexer {
+public:
+    Lexer(std::string_view source, uint32_t firstLine) : data(source.data()), size(source.size()), line(firstLine - 1) {
+        stream.source = source;
+    }
+
+    TokenStream run();
+
+private:
+    const char* data;
+    size_t size;
+    size_t pos = 0;
+    size_t lineStart = 0;
+    uint32_t line;
+    uint32_t lineFirstToken = 0;
+    TokenStream stream;
+
+    void lexLine();
+    void lexString();
+    void lexRunPath();
+    bool negativeAllowed() const;
+    void push(TokenType type, size_t start) {
+        stream.tokens.push_back({ type, static_cast<uint32_t>(start), static_cast<uint32_t>(pos - start), line,
+                                  static_cast<uint32_t>(start - lineStart + 1) });
+    }
+    [[noreturn]] void fail(const std::string& message) const { throw ScriptError(static_cast<int>(line), message); }
+};
+
+TokenStream Lexer::run() {
+    if (size > std::numeric_limits<uint32_t>::max()) {
+        throw ScriptError(0, "Source is too large.");
+    }
+    // Token density varies several-fold between scripts, so instead of
+    // guessing up front, the vector grows over the first few kilobytes and is
+    // then reserved once for the whole source at the density seen so far.
+    const size_t sampleBytes = 4096;
+    bool reserved = size <= sampleBytes;
+
+    while (pos < size) {
+        ++line;
+        lineStart = pos;
+        uint32_t indent = 0;
+        for (; pos < size; ++pos) {
+            if (data[pos] == ' ') ++indent;
+            else if (data[pos] == '\t') indent += 4;
+            else break;
+        }
+
+        lineFirstToken = static_cast<uint32_t>(stream.tokens.size());
+        lexLine();
+        if (!reserved && pos >= sampleBytes) {
+            reserved = true;
+            size_t estimate = stream.tokens.size() * size / pos;
+            stream.tokens.reserve(estimate + estimate / 8);
+        }
+        uint32_t count = static_cast<uint32_t>(stream.tokens.size()) - lineFirstToken;
+        if (count > 0) {
+            stream.lines.push_back({ line, indent, lineFirstToken, count });
+        }
+    }
+    return std::move(stream);
+}
+
+void Lexer::lexLine() {
+    while (pos < size) {
+        char c = data[pos];
+        // Most gaps are a single space; only longer runs go to the vector scanner.
+        if (isBlank(c)) {
+            ++pos;
+            if (pos < size && isBlank(data[pos])) pos = skipBlanks(data, pos + 1, size);
+            continue;
+        }
+        if (c == '\n') {
+            ++pos;
+            return;
+        }
+        if (c == '#') {
+            const void* end = std::memchr(data + pos, '\n', size - pos);
+            pos = end ? static_cast<size_t>(static_cast<const char*>(end) - data) : size;
+            continue;
+        }
+
+        size_t start = pos;
+        if (isIdentifierStart(c)) {
+            pos = scanIdentifier(data, pos + 1, size);
+            // `lib.name` is one identifier: a name inside an imported module.
+            while (pos + 1 < size && data[pos] == '.' && isIdentifierStart(data[pos + 1])) {
+                pos = scanIdentifier(data, pos + 2, size);
+            }
+            TokenType type = keywordType(data + start, pos - start);
+            push(type, start);
+            if (type == RUN || type == IMPORT) lexRunPath();
+        } else if (isDigit(c) || (c == '-' && negativeAllowed() && pos + 1 < size && (isDigit(data[pos + 1]) || data[pos + 1] == '.'))) {
+            pos = scanDigits(data, pos + 1, size);
+            // In `0..10` the range operator ends the first number.
+            size_t range = std::string_view(data + start, pos - start).find("..");
+            if (range != std::string_view::npos) pos = start + range;
+            push(NUMBER, start);
+        } else if (c == '"') {
+            lexString();
+        } else if ((c == '=' || c == '!' || c == '<' || c == '>') && pos + 1 < size && data[pos + 1] == '=') {
+            pos += 2;
+            push(OPERATOR, start);
+        } else if (c == ',' || c == '<' || c == '>' || c == '+' || c == '-' || c == '*' || c == '/' || c == '^' ||
+                   c == '(' || c == ')' || c == '[' || c == ']') {
+            ++pos;
+            push(OPERATOR, start);
+        } else if (c == '.' && pos + 1 < size && data[pos + 1] == '.') {
+            pos += 2;
+            push(OPERATOR, start);
+        } else if (c == '=') {
+            ++pos;
+            push(ASSIGNMENT, start);
+        } else {
+            fail("Invalid token at: " + std::string(1, c));
+        }
+    }
+}
+
+void Lexer::lexString() {
+    size_t start = ++pos;
+    for (;;) {
+        pos = scanStringBody(data, pos, size);
+        if (pos >= size || data[pos] == '\n') {
+            fail("Unterminated string literal");
+        }
+        if (data[pos] == '"') break;
+        // A backslash escapes the next character, but never the line break.
+        pos += (pos + 1 < size && data[pos + 1] != '\n') ? 2 : 1;
+    }
+    push(STRING_LITERAL, start);
+    ++pos;
+}
+
+// The path after `run` or `import` is taken verbatim up to the next whitespace.
+void Lexer::lexRunPath() {
+    pos = skipBlanks(data, pos, size);
+    size_t start = pos;
+    while (pos < size && !isBlank(data[pos]) && data[pos] != '\n') ++pos;
+    if (pos > start) push(STRING_LITERAL, start);
+}
+
+bool Lexer::negativeAllowed() const {
+    if (stream.tokens.size() == lineFirstToken) return true;
+    const Token& previous = stream.tokens.back();
+    if (previous.type == OPERATOR) return data[previous.offset] != ')' && data[previous.offset] != ']';
+    return previous.type == ASSIGNMENT || previous.type == SEND || previous.type == IF || previous.type == WHILE ||
+           previous.type == IN;
+}
+
+}
+
+TokenStream tokenize(std::string_view source, uint32_t firstLine) {
+    return Lexer(source, firstLine).run();
+}
@@ -0,0 +1,31 @@
+#ifndef LEXER_HPP
+#define LEXER_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Token.hpp"
+
+// A source line that holds at least one token. Blank and comment-only lines
+// are not recorded.
+struct SourceLine {
+    uint32_t number;
+    uint32_t indent;
+    uint32_t firstToken;
+    uint32_t tokenCount;
+};
+
+// Tokens for a whole source buffer. The buffer must outlive the stream.
+struct TokenStream {
+    std::string_view source;
+    std::vector<Token> tokens;
+    std::vector<SourceLine> lines;
+
+    std::string_view text(const Token& token) const { return source.substr(token.offset, token.length); }
+};
+
+// Throws ScriptError with the offending line number on invalid input. Line
+// numbers start at `firstLine`, so a chunk of a larger file keeps its numbering.
+TokenStream tokenize(std::string_view source, uint32_t firstLine = 1);
+
+#endif
@@ -0,0 +1,50 @@
+#include "LineReader.hpp"
+#include <algorithm>
+#include <cstring>
+
+static const size_t blockSize = 64 * 1024;
+
+bool LineReader::readLine(std::string& line) {
+    line.clear();
+    for (;;) {
+        if (position == end) {
+            position = end = 0;
+            if (!fill()) return !line.empty();
+        }
+        const char* start = buffer.data() + position;
+        const char* newline = static_cast<const char*>(std::memchr(start, '\n', end - position));
+        if (newline) {
+            line.append(start, newline);
+            position += newline - start + 1;
+            return true;
+        }
+        line.append(start, end - position);
+        position = end;
+    }
+}
+
+void LineReader::reset(std::istream& stream) {
+    this->stream = &stream;
+    position = end = 0;
+    ended = false;
+}
+
+bool LineReader::fill() {
+    if (ended) return false;
+    if (buffer.empty()) buffer.resize(blockSize);
+
+    std::streambuf* source = stream->rdbuf();
+    // Only take what the stream already buffers; sgetc() refills it with a
+    // single read, which returns early for terminals and pipes.
+    std::streamsize available = source ? source->in_avail() : -1;
+    if (available <= 0 && source && source->sgetc() != std::char_traits<char>::eof()) {
+        available = std::max<std::streamsize>(source->in_avail(), 1);
+    }
+    if (available <= 0) {
+        ended = true;
+        stream->setstate(std::ios::eofbit);
+        return false;
+    }
+    end = static_cast<size_t>(source->sgetn(buffer.data(), std::min<std::streamsize>(available, blockSize)));
+    return end > 0;
+}
@@ -0,0 +1,36 @@
+#ifndef LINEREADER_HPP
+#define LINEREADER_HPP
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// Reads lines from a stream in large blocks, for streaming big inputs through
+// `input`. A read only waits for the data the stream already has available,
+// so an interactive terminal still gets one line at a time. Once a reader is
+// used, the stream should not be read directly: the reader may hold lines
+// that follow the one it returned.
+class LineReader {
+public:
+    explicit LineReader(std::istream& stream) : stream(&stream) {}
+
+    // Reads the next line without its newline. Returns false when the stream
+    // has ended and no text is left.
+    bool readLine(std::string& line);
+
+    // Reads from another stream, dropping anything buffered from the old one.
+    void reset(std::istream& stream);
+
+private:
+    std::istream* stream;
+    std::vector<char> buffer;
+    size_t position = 0;
+    size_t end = 0;
+    bool ended = false;
+
+    // Moves what the stream has available into the buffer. Returns false at
+    // the end of the stream.
+    bool fill();
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "Memo.hpp"
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <string>
+
+namespace {
+
+size_t combine(size_t seed, size_t hash) {
+    return seed ^ (hash + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+}
+
+// Equal doubles hash alike, so 0.0 and -0.0 share a bucket.
+size_t hashDouble(double value) {
+    if (value == 0) return 0;
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return std::hash<uint64_t>()(bits);
+}
+
+size_t hashValue(const Value& value) {
+    size_t hash = static_cast<size_t>(value.type());
+    switch (value.type()) {
+        case Value::Type::Undefined:
+            break;
+        case Value::Type::Float:
+            hash = combine(hash, hashDouble(value.asNumber()));
+            break;
+        case Value::Type::Integer:
+            hash = combine(hash, std::hash<int64_t>()(value.asInteger()));
+            break;
+        case Value::Type::BigInt: {
+            std::string digits;
+            value.asBigInt().appendTo(digits);
+            hash = combine(hash, std::hash<std::string>()(digits));
+            break;
+        }
+        case Value::Type::Boolean:
+            hash = combine(hash, value.asBoolean());
+            break;
+        case Value::Type::String:
+            hash = combine(hash, std::hash<std::string>()(value.asString()));
+            break;
+        case Value::Type::Function:
+            hash = combine(hash, std::hash<const void*>()(&value.asFunction()));
+            break;
+        case Value::Type::Array:
+            for (double element : value.asArray()) {
+                hash = combine(hash, hashDouble(element));
+            }
+            break;
+    }
+    return hash;
+}
+
+size_t hashArgs(const Value* args, size_t count) {
+    size_t hash = count;
+    for (size_t i = 0; i < count; ++i) {
+        hash = combine(hash, hashValue(args[i]));
+    }
+    return hash;
+}
+
+bool sameArgs(const std::vector<Value>& cached, const Value* args, size_t count) {
+    if (cached.size() != count) return false;
+    for (size_t i = 0; i < count; ++i) {
+        if (cached[i].type() != args[i].type() || !cached[i].equals(args[i])) return false;
+    }
+    return true;
+}
+
+}
+
+const std::vector<Value>* MemoTable::find(const Value* args, size_t count) {
+    auto range = index.equal_range(hashArgs(args, count));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (sameArgs(it->second->args, args, count)) {
+            entries.splice(entries.begin(), entries, it->second);
+            ++hits;
+            return &entries.front().outputs;
+        }
+    }
+    ++misses;
+    if (misses >= probeMisses && hits * 4 < misses) {
+        enabled = false;
+        entries.clear();
+        index.clear();
+    }
+    return nullptr;
+}
+
+void MemoTable::insert(std::vector<Value> args, std::vector<Value> outputs) {
+    if (capacity == 0) return;
+    if (entries.size() >= capacity) {
+        const Entry& oldest = entries.back();
+        auto range = index.equal_range(oldest.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second == std::prev(entries.end())) {
+                index.erase(it);
+                break;
+            }
+        }
+        entries.pop_back();
+    }
+    size_t hash = hashArgs(args.data(), args.size());
+    entries.push_front({ std::move(args), std::move(outputs), hash });
+    index.emplace(hash, entries.begin());
+}
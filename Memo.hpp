@@ -0,0 +1,45 @@
+#ifndef MEMO_HPP
+#define MEMO_HPP
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "Value.hpp"
+
+// Cached calls of one pure function: for each list of argument values, the
+// values the call left in the function's output globals. Arguments match only
+// values of the same type, so 1 and 1.0 are cached separately. When the table
+// is full, the least recently used call is dropped.
+//
+// Recording a call costs more than a cheap function body, so a table whose
+// calls rarely repeat turns itself off: once it has missed `probeMisses`
+// times, it stays on only while at least one lookup in five hits.
+class MemoTable {
+public:
+    explicit MemoTable(size_t capacity) : capacity(capacity) {}
+
+    // Returns the outputs cached for these arguments, or null.
+    const std::vector<Value>* find(const Value* args, size_t count);
+    void insert(std::vector<Value> args, std::vector<Value> outputs);
+    size_t size() const { return entries.size(); }
+    bool isEnabled() const { return enabled; }
+
+    static const size_t probeMisses = 1024;
+
+private:
+    struct Entry {
+        std::vector<Value> args;
+        std::vector<Value> outputs;
+        size_t hash;
+    };
+
+    size_t capacity;
+    size_t hits = 0;
+    size_t misses = 0;
+    bool enabled = true;
+    // Most recently used first.
+    std::list<Entry> entries;
+    std::unordered_multimap<size_t, std::list<Entry>::iterator> index;
+};
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef NATIVE_HPP
+#define NATIVE_HPP
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Value.hpp"
+
+class Interpreter;
+
+// What a native function accepts for one argument. Number takes any number;
+// Integer only whole numbers that fit in 64 bits.
+enum class NativeType { Any, Number, Integer, String, Boolean, Array };
+
+// The arguments of one call to a native function. They are the caller's own
+// values, not copies, so views into them stay valid until the function
+// returns. Each accessor requires the argument to have the matching type,
+// which the declared parameter types guarantee.
+class NativeCall {
+public:
+    NativeCall(Interpreter& interpreter, const Value* args, size_t count)
+        : interpreter_(interpreter), args(args), count(count) {}
+
+    size_t size() const { return count; }
+    const Value& operator[](size_t index) const { return args[index]; }
+
+    double number(size_t index) const { return args[index].asNumber(); }
+    int64_t integer(size_t index) const { return args[index].asInteger(); }
+    bool boolean(size_t index) const { return args[index].asBoolean(); }
+    std::string_view string(size_t index) const { return args[index].asString(); }
+    const std::vector<double>& array(size_t index) const { return args[index].asArray(); }
+
+    // For setting globals or writing output. Running script code on it from
+    // inside a native function is not supported.
+    Interpreter& interpreter() const { return interpreter_; }
+
+private:
+    Interpreter& interpreter_;
+    const Value* args;
+    size_t count;
+};
+
+// A C++ function that scripts call like a `func`. Like a `func`, it hands
+// results back by assigning globals; errors are reported by throwing.
+struct NativeFunction {
+    std::string name;
+    std::vector<NativeType> params;
+    std::function<void(NativeCall&)> body;
+};
+
+#endif
@@ -0,0 +1,549 @@
+#include "Optimizer.hpp"
+#include "Interpreter.hpp"
+#include <exception>
+
+void Optimizer::optimize(Program& program) {
+    if (level <= 0) return;
+    if (level >= 2) countAssignments(program.statements, nullptr);
+    optimizeBlock(program.statements, Constants());
+}
+
+// With `locals` null this counts global assignments, including those inside
+// function bodies; otherwise it counts the locals of one function body.
+void Optimizer::countAssignments(const Block& block, std::vector<uint32_t>* locals) {
+    for (const StmtPtr& stmt : block) {
+        switch (stmt->kind) {
+            case Stmt::Kind::Send:
+                countAssignments(*static_cast<const SendStmt&>(*stmt).value, locals);
+                break;
+            case Stmt::Kind::Assign: {
+                const auto& assign = static_cast<const AssignStmt&>(*stmt);
+                countAssignments(*assign.value, locals);
+                countSlot(assign.slot, locals);
+                break;
+            }
+            case Stmt::Kind::Call:
+                for (const ExprPtr& arg : static_cast<const CallStmt&>(*stmt).args) {
+                    countAssignments(*arg, locals);
+                }
+                break;
+            case Stmt::Kind::FuncDef: {
+                const auto& def = static_cast<const FuncDefStmt&>(*stmt);
+                countSlot(def.slot, locals);
+                if (!locals) countAssignments(def.function->body, nullptr);
+                break;
+            }
+            case Stmt::Kind::If: {
+                const auto& ifStmt = static_cast<const IfStmt&>(*stmt);
+                for (const IfBranch& branch : ifStmt.branches) {
+                    countAssignments(*branch.condition, locals);
+                    countAssignments(branch.body, locals);
+                }
+                countAssignments(ifStmt.elseBody, locals);
+                break;
+            }
+            case Stmt::Kind::While: {
+                const auto& whileStmt = static_cast<const WhileStmt&>(*stmt);
+                countAssignments(*whileStmt.condition, locals);
+                countAssignments(whileStmt.body, locals);
+                break;
+            }
+            case Stmt::Kind::For: {
+                const auto& forStmt = static_cast<const ForStmt&>(*stmt);
+                countAssignments(*forStmt.start, locals);
+                countAssignments(*forStmt.end, locals);
+                countSlot(forStmt.slot, locals);
+                countAssignments(forStmt.body, locals);
+                break;
+            }
+            case Stmt::Kind::Run:
+            case Stmt::Kind::Import:
+            case Stmt::Kind::Exit:
+                break;
+        }
+    }
+}
+
+void Optimizer::countAssignments(const Expr& expr, std::vector<uint32_t>* locals) {
+    switch (expr.kind) {
+        case Expr::Kind::Input: {
+            const auto& input = static_cast<const InputExpr&>(expr);
+            if (!input.target.empty()) countSlot(input.slot, locals);
+            break;
+        }
+        case Expr::Kind::Binary: {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            countAssignments(*binary.left, locals);
+            countAssignments(*binary.right, locals);
+            break;
+        }
+        case Expr::Kind::Compare: {
+            const auto& compare = static_cast<const CompareExpr&>(expr);
+            countAssignments(*compare.left, locals);
+            countAssignments(*compare.right, locals);
+            break;
+        }
+        case Expr::Kind::Array:
+            for (const ExprPtr& element : static_cast<const ArrayExpr&>(expr).elements) {
+                countAssignments(*element, locals);
+            }
+            break;
+        case Expr::Kind::Index: {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            countAssignments(*index.target, locals);
+            countAssignments(*index.index, locals);
+            break;
+        }
+        case Expr::Kind::Builtin:
+            for (const ExprPtr& arg : static_cast<const BuiltinExpr&>(expr).args) {
+                countAssignments(*arg, locals);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+void Optimizer::countSlot(Slot slot, std::vector<uint32_t>* locals) {
+    if (slot.local && locals) {
+        ++(*locals)[slot.index];
+    } else if (!slot.local && !locals) {
+        ++globalAssignments[slot.index];
+    }
+}
+
+void Optimizer::optimizeBlock(Block& block, Constants known) {
+    Block optimized;
+    optimized.reserve(block.size());
+    for (StmtPtr& stmt : block) {
+        optimizeStatement(std::move(stmt), known, optimized);
+    }
+    block = std::move(optimized);
+}
+
+// Appends the optimized statement to `out`: unchanged, rewritten, replaced by
+// the body of the branch that always runs, or not at all.
+void Optimizer::optimizeStatement(StmtPtr stmt, Constants& known, Block& out) {
+    switch (stmt->kind) {
+        case Stmt::Kind::Send:
+            fold(static_cast<SendStmt&>(*stmt).value, known);
+            break;
+        case Stmt::Kind::Assign: {
+            auto& assign = static_cast<AssignStmt&>(*stmt);
+            fold(assign.value, known);
+            remember(assign.slot, *assign.value, known);
+            break;
+        }
+        case Stmt::Kind::Call:
+            for (ExprPtr& arg : static_cast<CallStmt&>(*stmt).args) {
+                fold(arg, known);
+            }
+            known.globals.clear();
+            break;
+        case Stmt::Kind::FuncDef:
+            optimizeFunction(*static_cast<FuncDefStmt&>(*stmt).function);
+            break;
+        case Stmt::Kind::If: {
+            auto& ifStmt = static_cast<IfStmt&>(*stmt);
+            std::vector<IfBranch> kept;
+            for (IfBranch& branch : ifStmt.branches) {
+                fold(branch.condition, known);
+                if (!isLiteral(branch.condition)) {
+                    kept.push_back(std::move(branch));
+                } else if (literal(branch.condition).isTruthy()) {
+                    ifStmt.elseBody = std::move(branch.body);
+                    break;
+                }
+            }
+            if (kept.empty()) {
+                for (StmtPtr& inner : ifStmt.elseBody) {
+                    optimizeStatement(std::move(inner), known, out);
+                }
+                return;
+            }
+            ifStmt.branches = std::move(kept);
+            for (IfBranch& branch : ifStmt.branches) {
+                optimizeBlock(branch.body, known);
+            }
+            optimizeBlock(ifStmt.elseBody, known);
+            if (mayCall(ifStmt)) known.globals.clear();
+            break;
+        }
+        case Stmt::Kind::While: {
+            // The condition and body run again after the body, so a call
+            // anywhere in the loop makes every global unknown throughout it.
+            auto& whileStmt = static_cast<WhileStmt&>(*stmt);
+            if (mayCall(whileStmt.body)) known.globals.clear();
+            fold(whileStmt.condition, known);
+            if (isLiteral(whileStmt.condition) && !literal(whileStmt.condition).isTruthy()) return;
+            optimizeBlock(whileStmt.body, known);
+            break;
+        }
+        case Stmt::Kind::For: {
+            auto& forStmt = static_cast<ForStmt&>(*stmt);
+            fold(forStmt.start, known);
+            fold(forStmt.end, known);
+            if (mayCall(forStmt.body)) known.globals.clear();
+            optimizeBlock(forStmt.body, known);
+            break;
+        }
+        case Stmt::Kind::Run:
+        case Stmt::Kind::Import:
+            known.globals.clear();
+            break;
+        case Stmt::Kind::Exit:
+            break;
+    }
+    out.push_back(std::move(stmt));
+}
+
+// Function bodies start with nothing known: they may run at any time.
+void Optimizer::optimizeFunction(FunctionDef& definition) {
+    const FunctionDef* enclosing = function;
+    std::vector<uint32_t> enclosingAssignments = std::move(localAssignments);
+
+    function = &definition;
+    localAssignments.assign(definition.locals.size(), 0);
+    if (level >= 2) countAssignments(definition.body, &localAssignments);
+    optimizeBlock(definition.body, Constants());
+
+    function = enclosing;
+    localAssignments = std::move(enclosingAssignments);
+}
+
+void Optimizer::fold(ExprPtr& expr, const Constants& known) {
+    switch (expr->kind) {
+        case Expr::Kind::Literal:
+        case Expr::Kind::Input:
+            break;
+        case Expr::Kind::Variable: {
+            const auto& variable = static_cast<const VariableExpr&>(*expr);
+            const auto& values = variable.slot.local ? known.locals : known.globals;
+            auto found = values.find(variable.slot.index);
+            if (found != values.end()) expr = std::make_unique<LiteralExpr>(expr->line, found->second);
+            break;
+        }
+        case Expr::Kind::Template: {
+            auto& parts = static_cast<TemplateExpr&>(*expr).parts;
+            std::vector<TemplatePart> merged;
+            for (TemplatePart& part : parts) {
+                if (part.isVariable) {
+                    const auto& values = part.slot.local ? known.locals : known.globals;
+                    auto found = values.find(part.slot.index);
+                    if (found == values.end()) {
+                        merged.push_back(std::move(part));
+                        continue;
+                    }
+                    part = { false, found->second.toString(), Slot() };
+                }
+                if (!merged.empty() && !merged.back().isVariable) {
+                    merged.back().text += part.text;
+                } else {
+                    merged.push_back(std::move(part));
+                }
+            }
+            if (merged.size() == 1 && !merged[0].isVariable) {
+                expr = std::make_unique<LiteralExpr>(expr->line, Value::string(std::move(merged[0].text)));
+            } else {
+                parts = std::move(merged);
+            }
+            break;
+        }
+        case Expr::Kind::Binary: {
+            auto& binary = static_cast<BinaryExpr&>(*expr);
+            fold(binary.left, known);
+            fold(binary.right, known);
+            if (!isLiteral(binary.left) || !isLiteral(binary.right)) break;
+            try {
+                Value value = Interpreter::applyOperator(binary.op, literal(binary.left), literal(binary.right));
+                expr = std::make_unique<LiteralExpr>(expr->line, std::move(value));
+            } catch (const std::exception&) {
+            }
+            break;
+        }
+        case Expr::Kind::Compare: {
+            auto& compare = static_cast<CompareExpr&>(*expr);
+            fold(compare.left, known);
+            fold(compare.right, known);
+            if (!isLiteral(compare.left) || !isLiteral(compare.right)) break;
+            try {
+                Value value = Interpreter::compareValues(compare.op, literal(compare.left), literal(compare.right));
+                expr = std::make_unique<LiteralExpr>(expr->line, std::move(value));
+            } catch (const std::exception&) {
+            }
+            break;
+        }
+        case Expr::Kind::Array: {
+            auto& elements = static_cast<ArrayExpr&>(*expr).elements;
+            std::vector<Value> values;
+            for (ExprPtr& element : elements) {
+                fold(element, known);
+                if (isLiteral(element)) values.push_back(literal(element));
+            }
+            if (values.size() != elements.size()) break;
+            try {
+                expr = std::make_unique<LiteralExpr>(expr->line, Interpreter::makeArray(values.data(), values.size()));
+            } catch (const std::exception&) {
+            }
+            break;
+        }
+        case Expr::Kind::Index: {
+            auto& index = static_cast<IndexExpr&>(*expr);
+            fold(index.target, known);
+            fold(index.index, known);
+            if (!isLiteral(index.target) || !isLiteral(index.index)) break;
+            try {
+                expr = std::make_unique<LiteralExpr>(expr->line, Interpreter::indexArray(literal(index.target), literal(index.index)));
+            } catch (const std::exception&) {
+            }
+            break;
+        }
+        case Expr::Kind::Builtin: {
+            auto& call = static_cast<BuiltinExpr&>(*expr);
+            Value args[2];
+            bool constant = true;
+            for (size_t i = 0; i < call.args.size(); ++i) {
+                fold(call.args[i], known);
+                if (isLiteral(call.args[i])) args[i] = literal(call.args[i]);
+                else constant = false;
+            }
+            if (!constant) break;
+            try {
+                expr = std::make_unique<LiteralExpr>(expr->line, Interpreter::callBuiltin(call.builtin, args));
+            } catch (const std::exception&) {
+            }
+            break;
+        }
+    }
+}
+
+// Parameters are assigned by every call, so they are never treated as constant.
+void Optimizer::remember(Slot slot, const Expr& value, Constants& known) {
+    if (level < 2 || value.kind != Expr::Kind::Literal) return;
+    if (slot.local) {
+        if (function && slot.index >= function->params.size() && localAssignments[slot.index] == 1) {
+            known.locals[slot.index] = static_cast<const LiteralExpr&>(value).value;
+        }
+    } else if (globalAssignments[slot.index] == 1) {
+        known.globals[slot.index] = static_cast<const LiteralExpr&>(value).value;
+    }
+}
+
+bool Optimizer::mayCall(const Block& block) {
+    for (const StmtPtr& stmt : block) {
+        if (mayCall(*stmt)) return true;
+    }
+    return false;
+}
+
+bool Optimizer::mayCall(const Stmt& stmt) {
+    switch (stmt.kind) {
+        case Stmt::Kind::Call:
+        case Stmt::Kind::Run:
+        case Stmt::Kind::Import:
+            return true;
+        case Stmt::Kind::If: {
+            const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+            for (const IfBranch& branch : ifStmt.branches) {
+                if (mayCall(branch.body)) return true;
+            }
+            return mayCall(ifStmt.elseBody);
+        }
+        case Stmt::Kind::While:
+            return mayCall(static_cast<const WhileStmt&>(stmt).body);
+        case Stmt::Kind::For:
+            return mayCall(static_cast<const ForStmt&>(stmt).body);
+        default:
+            return false;
+    }
+}
+
+namespace {
+
+void formatBlock(const Block& block, int indent, std::string& out);
+void formatExpr(const Expr& expr, std::string& out);
+
+void formatList(const std::vector<ExprPtr>& list, std::string& out) {
+    for (size_t i = 0; i < list.size(); ++i) {
+        if (i > 0) out += ", ";
+        formatExpr(*list[i], out);
+    }
+}
+
+// Operators apply left to right, so a nested operation on the right (or a
+// comparison anywhere) only keeps its meaning in parentheses.
+void formatOperand(const Expr& expr, bool parenthesize, std::string& out) {
+    if (parenthesize) out += '(';
+    formatExpr(expr, out);
+    if (parenthesize) out += ')';
+}
+
+void formatExpr(const Expr& expr, std::string& out) {
+    switch (expr.kind) {
+        case Expr::Kind::Literal: {
+            const Value& value = static_cast<const LiteralExpr&>(expr).value;
+            if (!value.isString()) {
+                value.appendTo(out);
+                break;
+            }
+            out += '"';
+            for (char c : value.asString()) {
+                if (c == '\n') out += "\\n";
+                else if (c == '\t') out += "\\t";
+                else if (c == '"' || c == '\\') (out += '\\') += c;
+                else out += c;
+            }
+            out += '"';
+            break;
+        }
+        case Expr::Kind::Template:
+            out += '"';
+            for (const TemplatePart& part : static_cast<const TemplateExpr&>(expr).parts) {
+                if (part.isVariable) out += '{' + part.text + '}';
+                else out += part.text;
+            }
+            out += '"';
+            break;
+        case Expr::Kind::Variable:
+            out += static_cast<const VariableExpr&>(expr).name;
+            break;
+        case Expr::Kind::Input: {
+            const auto& input = static_cast<const InputExpr&>(expr);
+            out += input.target.empty() ? "input" : "input " + input.target;
+            break;
+        }
+        case Expr::Kind::Binary: {
+            const auto& binary = static_cast<const BinaryExpr&>(expr);
+            formatOperand(*binary.left, binary.left->kind == Expr::Kind::Compare, out);
+            ((out += ' ') += binary.op) += ' ';
+            formatOperand(*binary.right, binary.right->kind == Expr::Kind::Binary || binary.right->kind == Expr::Kind::Compare, out);
+            break;
+        }
+        case Expr::Kind::Compare: {
+            static const char* const operators[] = { " == ", " != ", " < ", " > ", " <= ", " >= " };
+            const auto& compare = static_cast<const CompareExpr&>(expr);
+            formatOperand(*compare.left, compare.left->kind == Expr::Kind::Compare, out);
+            out += operators[static_cast<int>(compare.op)];
+            formatOperand(*compare.right, compare.right->kind == Expr::Kind::Compare, out);
+            break;
+        }
+        case Expr::Kind::Array:
+            out += '[';
+            formatList(static_cast<const ArrayExpr&>(expr).elements, out);
+            out += ']';
+            break;
+        case Expr::Kind::Index: {
+            const auto& index = static_cast<const IndexExpr&>(expr);
+            Expr::Kind kind = index.target->kind;
+            formatOperand(*index.target, kind == Expr::Kind::Binary || kind == Expr::Kind::Compare, out);
+            out += '[';
+            formatExpr(*index.index, out);
+            out += ']';
+            break;
+        }
+        case Expr::Kind::Builtin: {
+            const auto& call = static_cast<const BuiltinExpr&>(expr);
+            out += builtinName(call.builtin);
+            out += '(';
+            formatList(call.args, out);
+            out += ')';
+            break;
+        }
+    }
+}
+
+void formatStmt(const Stmt& stmt, int indent, std::string& out) {
+    std::string prefix(static_cast<size_t>(indent) * 4, ' ');
+    out += prefix;
+    switch (stmt.kind) {
+        case Stmt::Kind::Send:
+            out += "send ";
+            formatExpr(*static_cast<const SendStmt&>(stmt).value, out);
+            out += '\n';
+            break;
+        case Stmt::Kind::Assign: {
+            const auto& assign = static_cast<const AssignStmt&>(stmt);
+            if (assign.declaration) out += "variable ";
+            out += assign.name + " = ";
+            formatExpr(*assign.value, out);
+            out += '\n';
+            break;
+        }
+        case Stmt::Kind::Call: {
+            const auto& call = static_cast<const CallStmt&>(stmt);
+            out += call.name;
+            if (!call.args.empty()) out += ' ';
+            formatList(call.args, out);
+            out += '\n';
+            break;
+        }
+        case Stmt::Kind::FuncDef: {
+            const FunctionDef& function = *static_cast<const FuncDefStmt&>(stmt).function;
+            out += "func " + function.name;
+            for (size_t i = 0; i < function.params.size(); ++i) {
+                out += (i == 0 ? " " : ", ") + function.params[i];
+            }
+            out += '\n';
+            formatBlock(function.body, indent + 1, out);
+            break;
+        }
+        case Stmt::Kind::If: {
+            const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+            for (size_t i = 0; i < ifStmt.branches.size(); ++i) {
+                if (i > 0) out += prefix + "else ";
+                out += "if ";
+                formatExpr(*ifStmt.branches[i].condition, out);
+                out += '\n';
+                formatBlock(ifStmt.branches[i].body, indent + 1, out);
+            }
+            if (!ifStmt.elseBody.empty()) {
+                out += prefix + "else\n";
+                formatBlock(ifStmt.elseBody, indent + 1, out);
+            }
+            break;
+        }
+        case Stmt::Kind::While: {
+            const auto& whileStmt = static_cast<const WhileStmt&>(stmt);
+            out += "while ";
+            formatExpr(*whileStmt.condition, out);
+            out += '\n';
+            formatBlock(whileStmt.body, indent + 1, out);
+            break;
+        }
+        case Stmt::Kind::For: {
+            const auto& forStmt = static_cast<const ForStmt&>(stmt);
+            out += "for " + forStmt.name + " in ";
+            formatExpr(*forStmt.start, out);
+            out += "..";
+            formatExpr(*forStmt.end, out);
+            out += '\n';
+            formatBlock(forStmt.body, indent + 1, out);
+            break;
+        }
+        case Stmt::Kind::Run:
+            out += "run " + static_cast<const RunStmt&>(stmt).path + '\n';
+            break;
+        case Stmt::Kind::Import: {
+            const auto& import = static_cast<const ImportStmt&>(stmt);
+            out += "import " + import.path + " as " + import.name + '\n';
+            break;
+        }
+        case Stmt::Kind::Exit:
+            out += "exit\n";
+            break;
+    }
+}
+
+void formatBlock(const Block& block, int indent, std::string& out) {
+    for (const StmtPtr& stmt : block) {
+        formatStmt(*stmt, indent, out);
+    }
+}
+
+}
+
+std::string formatProgram(const Program& program) {
+    std::string out;
+    formatBlock(program.statements, 0, out);
+    return out;
+}
@@ -0,0 +1,55 @@
+#ifndef OPTIMIZER_HPP
+#define OPTIMIZER_HPP
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Ast.hpp"
+
+// Rewrites a resolved program before it runs.
+//   Level 1 folds operators applied to literals, removes if/else branches
+//   whose conditions are literals, and removes while loops that never run.
+//   Level 2 also replaces reads of variables that are assigned a literal
+//   exactly once in the program (or function) and never reassigned.
+// Operations that would fail at run time are left in place, so the error is
+// still reported on the same line when that code runs.
+class Optimizer {
+public:
+    explicit Optimizer(int level) : level(level) {}
+
+    void optimize(Program& program);
+
+private:
+    // Variables known to hold a literal at the current point, by slot index.
+    struct Constants {
+        std::unordered_map<uint32_t, Value> globals;
+        std::unordered_map<uint32_t, Value> locals;
+    };
+
+    int level;
+    std::unordered_map<uint32_t, uint32_t> globalAssignments;
+    // Assignments to each local of the function being optimized.
+    std::vector<uint32_t> localAssignments;
+    const FunctionDef* function = nullptr;
+
+    void countAssignments(const Block& block, std::vector<uint32_t>* locals);
+    void countAssignments(const Expr& expr, std::vector<uint32_t>* locals);
+    void countSlot(Slot slot, std::vector<uint32_t>* locals);
+
+    void optimizeBlock(Block& block, Constants known);
+    void optimizeStatement(StmtPtr stmt, Constants& known, Block& out);
+    void optimizeFunction(FunctionDef& definition);
+    void fold(ExprPtr& expr, const Constants& known);
+    void remember(Slot slot, const Expr& value, Constants& known);
+
+    static bool isLiteral(const ExprPtr& expr) { return expr->kind == Expr::Kind::Literal; }
+    static const Value& literal(const ExprPtr& expr) { return static_cast<const LiteralExpr&>(*expr).value; }
+    // Whether running the code may call into other code that can change globals.
+    static bool mayCall(const Block& block);
+    static bool mayCall(const Stmt& stmt);
+};
+
+// Formats a program as Synze source, for inspecting what the optimizer did.
+std::string formatProgram(const Program& program);
+
+#endif
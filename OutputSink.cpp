@@ -0,0 +1,12 @@
+#include "OutputSink.hpp"
+
+void OutputSink::flush() {
+    if (pending.empty()) return;
+    writeOut(pending.data(), pending.size());
+    pending.clear();
+}
+
+void StreamSink::writeOut(const char* data, size_t size) {
+    stream.write(data, static_cast<std::streamsize>(size));
+    stream.flush();
+}
@@ -0,0 +1,79 @@
+#ifndef OUTPUTSINK_HPP
+#define OUTPUTSINK_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// Where `send` output goes. Text collects in a buffer and reaches the target
+// according to the flush policy, or whenever the buffer fills up.
+class OutputSink {
+public:
+    // Line flushes after every line, Block after every top-level statement,
+    // Exit only when the buffer is full or the interpreter asks for it.
+    enum class FlushPolicy { Line, Block, Exit };
+
+    virtual ~OutputSink() = default;
+
+    void setFlushPolicy(FlushPolicy policy) { this->policy = policy; }
+    FlushPolicy getFlushPolicy() const { return policy; }
+
+    // Output may be built directly in the buffer; finish each line with endLine().
+    std::string& buffer() { return pending; }
+    void write(std::string_view text) {
+        pending.append(text.data(), text.size());
+        if (pending.size() >= capacity) flush();
+    }
+    void endLine() {
+        pending += '\n';
+        if (policy == FlushPolicy::Line || pending.size() >= capacity) flush();
+    }
+    void endBlock() {
+        if (policy != FlushPolicy::Exit) flush();
+    }
+    void flush();
+
+protected:
+    virtual void writeOut(const char* data, size_t size) = 0;
+
+private:
+    static const size_t capacity = 64 * 1024;
+
+    std::string pending;
+    FlushPolicy policy = FlushPolicy::Line;
+};
+
+// Writes to a standard stream, flushing the stream along with the buffer.
+class StreamSink : public OutputSink {
+public:
+    explicit StreamSink(std::ostream& stream) : stream(stream) {}
+    ~StreamSink() override { flush(); }
+
+protected:
+    void writeOut(const char* data, size_t size) override;
+
+private:
+    std::ostream& stream;
+};
+
+// Keeps all output in memory, for embedding and tests.
+class StringSink : public OutputSink {
+public:
+    const std::string& str() {
+        flush();
+        return text;
+    }
+    void clear() {
+        flush();
+        text.clear();
+    }
+
+protected:
+    void writeOut(const char* data, size_t size) override { text.append(data, size); }
+
+private:
+    std::string text;
+};
+
+#endif
@@ -0,0 +1,444 @@
+#include "Parser.hpp"
+#include "Lexer.hpp"
+#include "ScriptError.hpp"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+
+Parser::Parser(std::string_view source, int firstLine) : stream(tokenize(source, static_cast<uint32_t>(firstLine))) {
+    lines.reserve(stream.lines.size());
+    for (const SourceLine& line : stream.lines) {
+        lines.push_back({ static_cast<int>(line.number), static_cast<int>(line.indent), stream.tokens.data() + line.firstToken, line.tokenCount });
+    }
+}
+
+Program Parser::parse() {
+    Program program;
+    program.statements = parseBlock(-1, nullptr);
+    return program;
+}
+
+Block Parser::parseBlock(int parentIndent, const char* owner) {
+    Block block;
+    int blockIndent = -1;
+
+    while (current < lines.size() && lines[current].indent > parentIndent) {
+        const Line& line = lines[current];
+        if (blockIndent < 0) {
+            blockIndent = line.indent;
+        } else if (line.indent != blockIndent) {
+            throw ScriptError(line.number, "Unexpected indentation.");
+        }
+        block.push_back(parseStatement());
+    }
+
+    if (owner && block.empty()) {
+        int lineNumber = current < lines.size() ? lines[current].number : (lines.empty() ? 0 : lines.back().number);
+        throw ScriptError(lineNumber, std::string("Expected an indented block after '") + owner + "'.");
+    }
+    return block;
+}
+
+StmtPtr Parser::parseStatement() {
+    const Line& line = lines[current++];
+    const Token* tokens = line.tokens;
+    size_t pos = 1;
+
+    switch (tokens[0].type) {
+        case FUNC:
+            return parseFunction(line, 0);
+        case PURE:
+            if (line.size < 2 || tokens[1].type != FUNC) {
+                throw ScriptError(line.number, "Expected 'func' after 'pure'.");
+            }
+            return parseFunction(line, 1);
+        case IF:
+            return parseIf(line);
+        case WHILE:
+            return parseWhile(line);
+        case FOR:
+            return parseFor(line);
+        case ELSE:
+            throw ScriptError(line.number, "'else' without a matching 'if'.");
+        case SEND: {
+            if (line.size < 2) {
+                throw ScriptError(line.number, "Expected a value after 'send'.");
+            }
+            ExprPtr value = parseExpression(line, pos);
+            expectEnd(line, pos);
+            return std::make_unique<SendStmt>(line.number, std::move(value));
+        }
+        case RUN:
+            if (line.size != 2) {
+                throw ScriptError(line.number, "Invalid run command. Syntax: run file.synze");
+            }
+            return std::make_unique<RunStmt>(line.number, std::string(text(tokens[1])));
+        case IMPORT:
+            return parseImport(line);
+        case EXIT:
+            expectEnd(line, pos);
+            return std::make_unique<ExitStmt>(line.number);
+        case VARIABLE:
+            if (line.size < 4 || tokens[1].type != IDENTIFIER || tokens[2].type != ASSIGNMENT) {
+                throw ScriptError(line.number, "Invalid variable declaration. Syntax: variable name = value");
+            }
+            pos = 3;
+            break;
+        case IDENTIFIER:
+            if (line.size < 2 || tokens[1].type != ASSIGNMENT) {
+                return parseCall(line);
+            }
+            if (line.size < 3) {
+                throw ScriptError(line.number, "Expected a value after '='.");
+            }
+            pos = 2;
+            break;
+        default:
+            throw ScriptError(line.number, "Unexpected token '" + std::string(text(tokens[0])) + "'.");
+    }
+
+    std::string name(text(tokens[pos - 2]));
+    ExprPtr value = parseExpression(line, pos);
+    expectEnd(line, pos);
+    return std::make_unique<AssignStmt>(line.number, name, std::move(value), tokens[0].type == VARIABLE);
+}
+
+StmtPtr Parser::parseFunction(const Line& line, size_t start) {
+    const Token* tokens = line.tokens + start;
+    size_t size = line.size - start;
+    if (size < 2 || tokens[1].type != IDENTIFIER) {
+        throw ScriptError(line.number, "Invalid function definition. Syntax: func name param1, param2");
+    }
+
+    auto function = std::make_shared<FunctionDef>();
+    function->name = std::string(text(tokens[1]));
+    function->declaredPure = start > 0;
+    for (size_t i = 2; i < size; ++i) {
+        if (tokens[i].type == IDENTIFIER && text(tokens[i]).find('.') == std::string_view::npos) {
+            function->params.emplace_back(text(tokens[i]));
+        } else if (text(tokens[i]) != ",") {
+            throw ScriptError(line.number, "Invalid parameter syntax in function definition.");
+        }
+    }
+
+    function->body = parseBlock(line.indent, "func");
+    function->locals = function->params;
+    collectLocals(function->body, function->locals);
+    return std::make_unique<FuncDefStmt>(line.number, std::move(function));
+}
+
+void Parser::collectLocals(const Block& block, std::vector<std::string>& locals) {
+    for (const StmtPtr& stmt : block) {
+        if (stmt->kind == Stmt::Kind::Assign) {
+            const auto& assign = static_cast<const AssignStmt&>(*stmt);
+            if (assign.declaration && std::find(locals.begin(), locals.end(), assign.name) == locals.end()) {
+                locals.push_back(assign.name);
+            }
+        } else if (stmt->kind == Stmt::Kind::If) {
+            const auto& ifStmt = static_cast<const IfStmt&>(*stmt);
+            for (const IfBranch& branch : ifStmt.branches) {
+                collectLocals(branch.body, locals);
+            }
+            collectLocals(ifStmt.elseBody, locals);
+        } else if (stmt->kind == Stmt::Kind::While) {
+            collectLocals(static_cast<const WhileStmt&>(*stmt).body, locals);
+        } else if (stmt->kind == Stmt::Kind::For) {
+            const auto& forStmt = static_cast<const ForStmt&>(*stmt);
+            if (std::find(locals.begin(), locals.end(), forStmt.name) == locals.end()) {
+                locals.push_back(forStmt.name);
+            }
+            collectLocals(forStmt.body, locals);
+        }
+    }
+}
+
+StmtPtr Parser::parseImport(const Line& line) {
+    const Token* tokens = line.tokens;
+    bool hasName = line.size == 4 && text(tokens[2]) == "as" && tokens[3].type == IDENTIFIER;
+    if (line.size != 2 && !hasName) {
+        throw ScriptError(line.number, "Invalid import. Syntax: import file.synze [as name]");
+    }
+
+    std::string path(text(tokens[1]));
+    std::string name;
+    if (hasName) {
+        name = std::string(text(tokens[3]));
+    } else {
+        size_t slash = path.find_last_of("/\\");
+        name = path.substr(slash == std::string::npos ? 0 : slash + 1);
+        if (name.size() > 6 && name.compare(name.size() - 6, 6, ".synze") == 0) name.resize(name.size() - 6);
+    }
+
+    bool valid = !name.empty() && !std::isdigit(static_cast<unsigned char>(name[0]));
+    for (char c : name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '_') valid = false;
+    }
+    if (!valid) {
+        throw ScriptError(line.number, "Invalid module name '" + name + "'. Use: import " + path + " as name");
+    }
+    return std::make_unique<ImportStmt>(line.number, std::move(path), std::move(name));
+}
+
+StmtPtr Parser::parseIf(const Line& line) {
+    auto stmt = std::make_unique<IfStmt>(line.number);
+
+    size_t pos = 1;
+    IfBranch first;
+    first.condition = parseExpression(line, pos);
+    expectEnd(line, pos);
+    first.body = parseBlock(line.indent, "if");
+    stmt->branches.push_back(std::move(first));
+
+    while (current < lines.size() && lines[current].indent == line.indent && lines[current].tokens[0].type == ELSE) {
+        const Line& elseLine = lines[current++];
+        if (elseLine.size > 1 && elseLine.tokens[1].type == IF) {
+            pos = 2;
+            IfBranch branch;
+            branch.condition = parseExpression(elseLine, pos);
+            expectEnd(elseLine, pos);
+            branch.body = parseBlock(elseLine.indent, "else if");
+            stmt->branches.push_back(std::move(branch));
+        } else {
+            expectEnd(elseLine, 1);
+            stmt->elseBody = parseBlock(elseLine.indent, "else");
+            break;
+        }
+    }
+    return stmt;
+}
+
+StmtPtr Parser::parseWhile(const Line& line) {
+    size_t pos = 1;
+    auto stmt = std::make_unique<WhileStmt>(line.number, parseExpression(line, pos));
+    expectEnd(line, pos);
+    stmt->body = parseBlock(line.indent, "while");
+    return stmt;
+}
+
+StmtPtr Parser::parseFor(const Line& line) {
+    const Token* tokens = line.tokens;
+    if (line.size < 6 || tokens[1].type != IDENTIFIER || tokens[2].type != IN) {
+        throw ScriptError(line.number, "Invalid for loop. Syntax: for name in start..end");
+    }
+
+    size_t pos = 3;
+    ExprPtr start = parseArithmetic(line, pos);
+    if (pos >= line.size || text(tokens[pos]) != "..") {
+        throw ScriptError(line.number, "Invalid for loop. Syntax: for name in start..end");
+    }
+    ++pos;
+    ExprPtr end = parseArithmetic(line, pos);
+    expectEnd(line, pos);
+
+    auto stmt = std::make_unique<ForStmt>(line.number, std::string(text(tokens[1])), std::move(start), std::move(end));
+    stmt->body = parseBlock(line.indent, "for");
+    return stmt;
+}
+
+StmtPtr Parser::parseCall(const Line& line) {
+    auto call = std::make_unique<CallStmt>(line.number, std::string(text(line.tokens[0])));
+    size_t pos = 1;
+
+    while (pos < line.size) {
+        call->args.push_back(parseExpression(line, pos));
+        if (pos < line.size) {
+            if (text(line.tokens[pos]) != ",") {
+                throw ScriptError(line.number, "Invalid syntax in function call.");
+            }
+            ++pos;
+        }
+    }
+    return call;
+}
+
+ExprPtr Parser::parseExpression(const Line& line, size_t& pos) {
+    ExprPtr left = parseArithmetic(line, pos);
+    if (pos >= line.size || line.tokens[pos].type != OPERATOR) return left;
+
+    std::string_view op = text(line.tokens[pos]);
+    CompareOp compareOp;
+    if (op == "==") compareOp = CompareOp::Equal;
+    else if (op == "!=") compareOp = CompareOp::NotEqual;
+    else if (op == "<") compareOp = CompareOp::Less;
+    else if (op == ">") compareOp = CompareOp::Greater;
+    else if (op == "<=") compareOp = CompareOp::LessEqual;
+    else if (op == ">=") compareOp = CompareOp::GreaterEqual;
+    else return left;
+
+    ++pos;
+    ExprPtr right = parseArithmetic(line, pos);
+    return std::make_unique<CompareExpr>(line.number, compareOp, std::move(left), std::move(right));
+}
+
+// Operators share one precedence level and apply strictly left to right, as
+// the original `send` accumulator did.
+ExprPtr Parser::parseArithmetic(const Line& line, size_t& pos) {
+    ExprPtr left = parseOperand(line, pos);
+
+    while (pos < line.size && line.tokens[pos].type == OPERATOR) {
+        std::string_view op = text(line.tokens[pos]);
+        if (op.size() != 1 || std::string_view("+-*/^").find(op[0]) == std::string_view::npos) break;
+        ++pos;
+        ExprPtr right = parseOperand(line, pos);
+        left = std::make_unique<BinaryExpr>(line.number, op[0], std::move(left), std::move(right));
+    }
+    return left;
+}
+
+// A primary value followed by any number of `[index]` suffixes.
+ExprPtr Parser::parseOperand(const Line& line, size_t& pos) {
+    ExprPtr operand = parsePrimary(line, pos);
+    while (isOperator(line, pos, "[")) {
+        ++pos;
+        ExprPtr index = parseExpression(line, pos);
+        expectOperator(line, pos, "]");
+        operand = std::make_unique<IndexExpr>(line.number, std::move(operand), std::move(index));
+    }
+    return operand;
+}
+
+ExprPtr Parser::parsePrimary(const Line& line, size_t& pos) {
+    if (pos >= line.size) {
+        throw ScriptError(line.number, "Expected a value.");
+    }
+
+    const Token& token = line.tokens[pos++];
+    std::string_view value = text(token);
+    switch (token.type) {
+        case NUMBER: {
+            Value integer;
+            if (value.find('.') == std::string_view::npos && parseInteger(value, integer)) {
+                return std::make_unique<LiteralExpr>(line.number, std::move(integer));
+            }
+            double number = 0;
+            auto result = std::from_chars(value.data(), value.data() + value.size(), number);
+            if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+                throw ScriptError(line.number, "Invalid number: " + std::string(value));
+            }
+            return std::make_unique<LiteralExpr>(line.number, Value::number(number));
+        }
+        case STRING_LITERAL:
+            return parseStringLiteral(line.number, value);
+        case IDENTIFIER:
+            if (value == "true" || value == "false") {
+                return std::make_unique<LiteralExpr>(line.number, Value::boolean(value == "true"));
+            }
+            if (isOperator(line, pos, "(")) {
+                for (int i = 0; i <= static_cast<int>(Builtin::Dot); ++i) {
+                    if (value == builtinName(static_cast<Builtin>(i))) return parseBuiltin(line, pos, static_cast<Builtin>(i));
+                }
+                throw ScriptError(line.number, "Unknown built-in function '" + std::string(value) + "'.");
+            }
+            if (value == "input") {
+                if (pos < line.size && line.tokens[pos].type == IDENTIFIER) {
+                    return std::make_unique<InputExpr>(line.number, std::string(text(line.tokens[pos++])));
+                }
+                return std::make_unique<InputExpr>(line.number, "");
+            }
+            return std::make_unique<VariableExpr>(line.number, std::string(value));
+        case OPERATOR:
+            if (value == "(") {
+                ExprPtr inner = parseExpression(line, pos);
+                expectOperator(line, pos, ")");
+                return inner;
+            }
+            if (value == "[") return parseArray(line, pos);
+            throw ScriptError(line.number, "Unexpected token '" + std::string(value) + "'.");
+        default:
+            throw ScriptError(line.number, "Unexpected token '" + std::string(value) + "'.");
+    }
+}
+
+// Called after the opening bracket.
+ExprPtr Parser::parseArray(const Line& line, size_t& pos) {
+    auto array = std::make_unique<ArrayExpr>(line.number);
+    if (isOperator(line, pos, "]")) {
+        ++pos;
+        return array;
+    }
+    for (;;) {
+        array->elements.push_back(parseExpression(line, pos));
+        if (!isOperator(line, pos, ",")) break;
+        ++pos;
+    }
+    expectOperator(line, pos, "]");
+    return array;
+}
+
+// Called with `pos` at the opening parenthesis.
+ExprPtr Parser::parseBuiltin(const Line& line, size_t& pos, Builtin builtin) {
+    auto call = std::make_unique<BuiltinExpr>(line.number, builtin);
+    ++pos;
+    if (!isOperator(line, pos, ")")) {
+        for (;;) {
+            call->args.push_back(parseExpression(line, pos));
+            if (!isOperator(line, pos, ",")) break;
+            ++pos;
+        }
+    }
+    expectOperator(line, pos, ")");
+
+    size_t arity = builtinArity(builtin);
+    if (call->args.size() != arity) {
+        throw ScriptError(line.number, std::string(builtinName(builtin)) + " expects " + std::to_string(arity) +
+                                           (arity == 1 ? " argument." : " arguments."));
+    }
+    return call;
+}
+
+ExprPtr Parser::parseStringLiteral(int lineNumber, std::string_view raw) {
+    std::string text;
+    text.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '\\' || i + 1 == raw.size()) {
+            text += raw[i];
+            continue;
+        }
+        switch (raw[++i]) {
+            case 'n': text += '\n'; break;
+            case 't': text += '\t'; break;
+            default: text += raw[i]; break;
+        }
+    }
+
+    if (text.find('{') == std::string::npos) {
+        return std::make_unique<LiteralExpr>(lineNumber, Value::string(std::move(text)));
+    }
+
+    auto tmpl = std::make_unique<TemplateExpr>(lineNumber);
+    std::string literal;
+    for (size_t j = 0; j < text.size(); ++j) {
+        if (text[j] != '{') {
+            literal += text[j];
+            continue;
+        }
+
+        size_t close = text.find('}', j + 1);
+        if (close == std::string::npos) {
+            throw ScriptError(lineNumber, "Unmatched '{' in string.");
+        }
+        if (!literal.empty()) {
+            tmpl->parts.push_back({ false, literal, Slot() });
+            literal.clear();
+        }
+        tmpl->parts.push_back({ true, text.substr(j + 1, close - j - 1), Slot() });
+        j = close;
+    }
+    if (!literal.empty()) {
+        tmpl->parts.push_back({ false, literal, Slot() });
+    }
+    return tmpl;
+}
+
+void Parser::expectOperator(const Line& line, size_t& pos, std::string_view op) {
+    if (!isOperator(line, pos, op)) {
+        throw ScriptError(line.number, "Expected '" + std::string(op) + "'.");
+    }
+    ++pos;
+}
+
+void Parser::expectEnd(const Line& line, size_t pos) {
+    if (pos < line.size) {
+        throw ScriptError(line.number, "Unexpected token '" + std::string(text(line.tokens[pos])) + "'.");
+    }
+}
@@ -0,0 +1,58 @@
+#ifndef PARSER_HPP
+#define PARSER_HPP
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Ast.hpp"
+#include "Lexer.hpp"
+
+// Turns Synze source into a Program. Blocks (function bodies, if/else
+// branches and loop bodies) are delimited by indentation, exactly as the line interpreter did.
+class Parser {
+public:
+    // The source must stay alive until parse() returns.
+    explicit Parser(std::string_view source, int firstLine = 1);
+
+    Program parse();
+
+private:
+    struct Line {
+        int number;
+        int indent;
+        const Token* tokens;
+        size_t size;
+    };
+
+    TokenStream stream;
+    std::vector<Line> lines;
+    size_t current = 0;
+
+    Block parseBlock(int parentIndent, const char* owner);
+    StmtPtr parseStatement();
+    // `start` is the index of the `func` token, after an optional `pure`.
+    StmtPtr parseFunction(const Line& line, size_t start);
+    StmtPtr parseIf(const Line& line);
+    StmtPtr parseWhile(const Line& line);
+    StmtPtr parseFor(const Line& line);
+    StmtPtr parseCall(const Line& line);
+    StmtPtr parseImport(const Line& line);
+    static void collectLocals(const Block& block, std::vector<std::string>& locals);
+
+    ExprPtr parseExpression(const Line& line, size_t& pos);
+    ExprPtr parseArithmetic(const Line& line, size_t& pos);
+    ExprPtr parseOperand(const Line& line, size_t& pos);
+    ExprPtr parsePrimary(const Line& line, size_t& pos);
+    ExprPtr parseArray(const Line& line, size_t& pos);
+    ExprPtr parseBuiltin(const Line& line, size_t& pos, Builtin builtin);
+    ExprPtr parseStringLiteral(int lineNumber, std::string_view raw);
+
+    std::string_view text(const Token& token) const { return stream.text(token); }
+    void expectEnd(const Line& line, size_t pos);
+    bool isOperator(const Line& line, size_t pos, std::string_view op) const {
+        return pos < line.size && line.tokens[pos].type == OPERATOR && text(line.tokens[pos]) == op;
+    }
+    void expectOperator(const Line& line, size_t& pos, std::string_view op);
+};
+
+#endif
@@ -0,0 +1,155 @@
+#include "Profiler.hpp"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+uint64_t lineKey(uint32_t file, int line) {
+    return (static_cast<uint64_t>(file) << 32) | static_cast<uint32_t>(line);
+}
+
+double milliseconds(std::chrono::steady_clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+}
+
+// Statements typed at the prompt belong to the root frame, file 0.
+Profiler::Profiler() {
+    started = Clock::now();
+    lastEvent = started;
+    pushFrame(nullptr, fileId("<repl>"), "<repl>", started);
+}
+
+void Profiler::enterFile(const std::string& path) {
+    Clock::time_point now = Clock::now();
+    chargeLine(now);
+    pushFrame(nullptr, fileId(path), path, now);
+}
+
+void Profiler::exitFile() {
+    if (frames.size() > 1) popFrame(Clock::now());
+}
+
+void Profiler::enterFunction(const std::shared_ptr<const FunctionDef>& function) {
+    Clock::time_point now = Clock::now();
+    chargeLine(now);
+    FunctionStats& stats = functions[function.get()];
+    if (!stats.function) stats.function = function;
+    pushFrame(function.get(), function->file.empty() ? 0 : fileId(function->file), function->name, now);
+}
+
+void Profiler::exitFunction() {
+    if (frames.size() > 1) popFrame(Clock::now());
+}
+
+void Profiler::line(int number) {
+    Clock::time_point now = Clock::now();
+    chargeLine(now);
+    currentLine = lineKey(frames.back().file, number);
+    ++lines[currentLine].hits;
+}
+
+void Profiler::finish() {
+    if (frames.empty()) return;
+    Clock::time_point now = Clock::now();
+    while (!frames.empty()) {
+        popFrame(now);
+    }
+    total = now - started;
+}
+
+uint32_t Profiler::fileId(const std::string& path) {
+    auto found = fileIds.find(path);
+    if (found != fileIds.end()) return found->second;
+    uint32_t id = static_cast<uint32_t>(files.size());
+    files.push_back(path);
+    fileIds.emplace(path, id);
+    return id;
+}
+
+// The caller's current line stops accumulating while the callee runs and
+// resumes when it returns.
+void Profiler::pushFrame(const FunctionDef* function, uint32_t file, const std::string& name, Clock::time_point now) {
+    FunctionStats* stats = function ? &functions[function] : nullptr;
+    std::string stack;
+    if (stats && stats->active > 0) {
+        stack = stats->stack;
+    } else {
+        stack = frames.empty() ? name : frames.back().stack + ';' + name;
+    }
+    if (stats) {
+        ++stats->calls;
+        if (stats->active++ == 0) stats->stack = stack;
+    }
+    frames.push_back({ function, file, std::move(stack), now, Clock::duration(0), currentLine });
+    currentLine = noLine;
+    lastEvent = now;
+}
+
+void Profiler::popFrame(Clock::time_point now) {
+    chargeLine(now);
+    Frame frame = std::move(frames.back());
+    frames.pop_back();
+
+    Clock::duration inclusive = now - frame.start;
+    Clock::duration exclusive = inclusive - frame.children;
+    stacks[frame.stack] += exclusive;
+    if (!frames.empty()) frames.back().children += inclusive;
+    if (frame.function) {
+        FunctionStats& stats = functions[frame.function];
+        stats.exclusive += exclusive;
+        if (--stats.active == 0) stats.inclusive += inclusive;
+    }
+
+    currentLine = frame.callerLine;
+    lastEvent = now;
+}
+
+void Profiler::chargeLine(Clock::time_point now) {
+    if (currentLine != noLine) lines[currentLine].time += now - lastEvent;
+    lastEvent = now;
+}
+
+void Profiler::writeReport(std::ostream& out) const {
+    char row[64];
+    std::snprintf(row, sizeof row, "%.3f", milliseconds(total));
+    out << "Total time: " << row << " ms\n\nFunctions by exclusive time\n";
+    out << "     calls   inclusive ms   exclusive ms  function\n";
+
+    std::vector<const FunctionStats*> sortedFunctions;
+    for (const auto& entry : functions) {
+        sortedFunctions.push_back(&entry.second);
+    }
+    std::sort(sortedFunctions.begin(), sortedFunctions.end(), [](const FunctionStats* a, const FunctionStats* b) {
+        return a->exclusive > b->exclusive;
+    });
+    for (const FunctionStats* stats : sortedFunctions) {
+        const FunctionDef& function = *stats->function;
+        std::snprintf(row, sizeof row, "%10llu %14.3f %14.3f  ", static_cast<unsigned long long>(stats->calls),
+                      milliseconds(stats->inclusive), milliseconds(stats->exclusive));
+        out << row << function.name << " (" << (function.file.empty() ? "<repl>" : function.file) << ':'
+            << function.line << ")\n";
+    }
+
+    out << "\nLines by time\n";
+    out << "      hits        time ms  line\n";
+    std::vector<std::pair<uint64_t, LineStats>> sortedLines(lines.begin(), lines.end());
+    std::sort(sortedLines.begin(), sortedLines.end(), [](const auto& a, const auto& b) {
+        return a.second.time != b.second.time ? a.second.time > b.second.time : a.first < b.first;
+    });
+    for (const auto& entry : sortedLines) {
+        std::snprintf(row, sizeof row, "%10llu %14.3f  ", static_cast<unsigned long long>(entry.second.hits),
+                      milliseconds(entry.second.time));
+        out << row << files[entry.first >> 32] << ':' << static_cast<uint32_t>(entry.first) << '\n';
+    }
+}
+
+void Profiler::writeCollapsed(std::ostream& out) const {
+    std::vector<std::pair<std::string, Clock::duration>> sortedStacks(stacks.begin(), stacks.end());
+    std::sort(sortedStacks.begin(), sortedStacks.end());
+    for (const auto& entry : sortedStacks) {
+        long long nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(entry.second).count();
+        if (nanoseconds > 0) out << entry.first << ' ' << nanoseconds << '\n';
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Ast.hpp"
+
+// Records where a script spends its time: hit counts and exclusive time per
+// source line, and calls plus inclusive and exclusive time per function. Files
+// run with `run` and function calls form the stack used for collapsed-stack
+// (flamegraph) output. The engines only report events while a profiler is set.
+class Profiler {
+public:
+    Profiler();
+
+    void enterFile(const std::string& path);
+    void exitFile();
+    void enterFunction(const std::shared_ptr<const FunctionDef>& function);
+    void exitFunction();
+    // A statement on this line of the current file or function starts running.
+    void line(int number);
+
+    // Closes every open frame; call before writing the results.
+    void finish();
+    // Functions sorted by exclusive time, then lines sorted by time.
+    void writeReport(std::ostream& out) const;
+    // One "frame;frame;frame nanoseconds" line per distinct stack.
+    void writeCollapsed(std::ostream& out) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame {
+        const FunctionDef* function;
+        uint32_t file;
+        std::string stack;
+        Clock::time_point start;
+        Clock::duration children{ 0 };
+        uint64_t callerLine;
+    };
+
+    struct FunctionStats {
+        std::shared_ptr<const FunctionDef> function;
+        uint64_t calls = 0;
+        Clock::duration inclusive{ 0 };
+        Clock::duration exclusive{ 0 };
+        // Recursive activations; inclusive time is only added by the outermost.
+        uint32_t active = 0;
+        // Collapsed stack of the outermost activation. Recursive calls reuse
+        // it, so stacks stay as short as the set of distinct functions.
+        std::string stack;
+    };
+
+    struct LineStats {
+        uint64_t hits = 0;
+        Clock::duration time{ 0 };
+    };
+
+    static const uint64_t noLine = ~0ull;
+
+    std::vector<std::string> files;
+    std::unordered_map<std::string, uint32_t> fileIds;
+    std::vector<Frame> frames;
+    std::unordered_map<const FunctionDef*, FunctionStats> functions;
+    std::unordered_map<uint64_t, LineStats> lines;
+    std::unordered_map<std::string, Clock::duration> stacks;
+    uint64_t currentLine = noLine;
+    Clock::time_point lastEvent;
+    Clock::time_point started;
+    Clock::duration total{ 0 };
+
+    uint32_t fileId(const std::string& path);
+    void pushFrame(const FunctionDef* function, uint32_t file, const std::string& name, Clock::time_point now);
+    void popFrame(Clock::time_point now);
+    void chargeLine(Clock::time_point now);
+};
+
+#endif
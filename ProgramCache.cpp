@@ -0,0 +1,636 @@
+#include "ProgramCache.hpp"
+#include "Encoding.hpp"
+#include "SourceFile.hpp"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Bump whenever the AST or this encoding changes; older caches are then
+// ignored and rewritten. Caches from another build are ignored as well.
+const uint32_t formatVersion = 7;
+const uint32_t byteOrderMark = 0x01020304;
+const char magic[8] = { 'S', 'Y', 'N', 'Z', 'E', 'C', 0, 0 };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    char build[32];
+    uint64_t sourceSize;
+    uint64_t sourceHash;
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+// Payload layout: identifier table, constant pool, then the statement tree.
+// Names and literals are written as indexes into the two tables. A resolved
+// program also gets every slot and what the Resolver and markPureFunctions()
+// recorded on its functions.
+class ProgramWriter {
+public:
+    explicit ProgramWriter(bool resolved = false) : resolved(resolved) {}
+
+    std::string write(const Program& program) {
+        block(program.statements);
+        return finish();
+    }
+
+    std::string write(const std::vector<const FunctionDef*>& functions) {
+        putIndex(body, static_cast<uint32_t>(functions.size()));
+        for (const FunctionDef* definition : functions) {
+            putIndex(body, static_cast<uint32_t>(definition->line));
+            function(*definition);
+        }
+        return finish();
+    }
+
+private:
+    bool resolved;
+    std::string body;
+    std::vector<std::string> symbols;
+    std::unordered_map<std::string, uint32_t> symbolIds;
+    std::vector<Value> constants;
+    std::unordered_map<std::string, uint32_t> stringIds;
+
+    std::string finish() {
+        std::string out;
+        putIndex(out, static_cast<uint32_t>(symbols.size()));
+        for (const std::string& name : symbols) {
+            putString(out, name);
+        }
+        putIndex(out, static_cast<uint32_t>(constants.size()));
+        for (const Value& value : constants) {
+            put(out, static_cast<uint8_t>(value.type()));
+            if (value.isFloat()) put(out, value.asNumber());
+            else if (value.isInteger()) put(out, value.asInteger());
+            else if (value.isBigInt()) putString(out, value.toString());
+            else if (value.isBoolean()) put(out, static_cast<uint8_t>(value.asBoolean()));
+            else if (value.isArray()) putArray(out, value.asArray());
+            else putString(out, value.asString());
+        }
+        out += body;
+        return out;
+    }
+
+    void symbol(const std::string& name) {
+        auto result = symbolIds.emplace(name, static_cast<uint32_t>(symbols.size()));
+        if (result.second) symbols.push_back(name);
+        putIndex(body, result.first->second);
+    }
+
+    void slot(Slot slot) {
+        if (resolved) putIndex(body, slot.index << 1 | static_cast<uint32_t>(slot.local));
+    }
+
+    static void putArray(std::string& out, const std::vector<double>& elements) {
+        putIndex(out, static_cast<uint32_t>(elements.size()));
+        for (double element : elements) {
+            put(out, element);
+        }
+    }
+
+    void constant(const Value& value) {
+        if (value.isString()) {
+            auto result = stringIds.emplace(value.asString(), static_cast<uint32_t>(constants.size()));
+            if (result.second) constants.push_back(value);
+            putIndex(body, result.first->second);
+            return;
+        }
+        if (!value.isNumber() && !value.isBoolean() && !value.isArray()) {
+            throw std::runtime_error(std::string("Cannot cache a ") + value.typeName() + " literal.");
+        }
+        putIndex(body, static_cast<uint32_t>(constants.size()));
+        constants.push_back(value);
+    }
+
+    void names(const std::vector<std::string>& list) {
+        putIndex(body, static_cast<uint32_t>(list.size()));
+        for (const std::string& name : list) {
+            symbol(name);
+        }
+    }
+
+    void function(const FunctionDef& function) {
+        symbol(function.name);
+        put(body, static_cast<uint8_t>(function.declaredPure));
+        names(function.params);
+        names(function.locals);
+        if (resolved) {
+            constant(Value::string(function.file));
+            put(body, static_cast<uint8_t>(function.pure));
+            putIndex(body, static_cast<uint32_t>(function.outputs.size()));
+            for (uint32_t output : function.outputs) {
+                slot({ false, output });
+            }
+            putIndex(body, static_cast<uint32_t>(function.inputs.size()));
+            for (uint32_t input : function.inputs) {
+                slot({ false, input });
+            }
+        }
+        block(function.body);
+    }
+
+    void block(const Block& statements) {
+        putIndex(body, static_cast<uint32_t>(statements.size()));
+        for (const StmtPtr& stmt : statements) {
+            statement(*stmt);
+        }
+    }
+
+    void statement(const Stmt& stmt) {
+        put(body, static_cast<uint8_t>(stmt.kind));
+        putIndex(body, static_cast<uint32_t>(stmt.line));
+        switch (stmt.kind) {
+            case Stmt::Kind::Send:
+                expression(*static_cast<const SendStmt&>(stmt).value);
+                break;
+            case Stmt::Kind::Assign: {
+                const auto& assign = static_cast<const AssignStmt&>(stmt);
+                symbol(assign.name);
+                slot(assign.slot);
+                put(body, static_cast<uint8_t>(assign.declaration));
+                expression(*assign.value);
+                break;
+            }
+            case Stmt::Kind::Call: {
+                const auto& call = static_cast<const CallStmt&>(stmt);
+                symbol(call.name);
+                slot(call.callee);
+                putIndex(body, static_cast<uint32_t>(call.args.size()));
+                for (const ExprPtr& arg : call.args) {
+                    expression(*arg);
+                }
+                break;
+            }
+            case Stmt::Kind::FuncDef: {
+                const auto& def = static_cast<const FuncDefStmt&>(stmt);
+                slot(def.slot);
+                function(*def.function);
+                break;
+            }
+            case Stmt::Kind::If: {
+                const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+                putIndex(body, static_cast<uint32_t>(ifStmt.branches.size()));
+                for (const IfBranch& branch : ifStmt.branches) {
+                    expression(*branch.condition);
+                    block(branch.body);
+                }
+                block(ifStmt.elseBody);
+                break;
+            }
+            case Stmt::Kind::While: {
+                const auto& whileStmt = static_cast<const WhileStmt&>(stmt);
+                expression(*whileStmt.condition);
+                block(whileStmt.body);
+                break;
+            }
+            case Stmt::Kind::For: {
+                const auto& forStmt = static_cast<const ForStmt&>(stmt);
+                symbol(forStmt.name);
+                slot(forStmt.slot);
+                expression(*forStmt.start);
+                expression(*forStmt.end);
+                block(forStmt.body);
+                break;
+            }
+            case Stmt::Kind::Run:
+                constant(Value::string(static_cast<const RunStmt&>(stmt).path));
+                break;
+            case Stmt::Kind::Import: {
+                const auto& import = static_cast<const ImportStmt&>(stmt);
+                constant(Value::string(import.path));
+                symbol(import.name);
+                break;
+            }
+            case Stmt::Kind::Exit:
+                break;
+        }
+    }
+
+    void expressions(const std::vector<ExprPtr>& list) {
+        putIndex(body, static_cast<uint32_t>(list.size()));
+        for (const ExprPtr& expr : list) {
+            expression(*expr);
+        }
+    }
+
+    void expression(const Expr& expr) {
+        put(body, static_cast<uint8_t>(expr.kind));
+        putIndex(body, static_cast<uint32_t>(expr.line));
+        switch (expr.kind) {
+            case Expr::Kind::Literal:
+                constant(static_cast<const LiteralExpr&>(expr).value);
+                break;
+            case Expr::Kind::Template: {
+                const auto& tmpl = static_cast<const TemplateExpr&>(expr);
+                putIndex(body, static_cast<uint32_t>(tmpl.parts.size()));
+                for (const TemplatePart& part : tmpl.parts) {
+                    put(body, static_cast<uint8_t>(part.isVariable));
+                    if (part.isVariable) {
+                        symbol(part.text);
+                        slot(part.slot);
+                    } else {
+                        constant(Value::string(part.text));
+                    }
+                }
+                break;
+            }
+            case Expr::Kind::Variable: {
+                const auto& variable = static_cast<const VariableExpr&>(expr);
+                symbol(variable.name);
+                slot(variable.slot);
+                break;
+            }
+            case Expr::Kind::Input: {
+                const auto& input = static_cast<const InputExpr&>(expr);
+                symbol(input.target);
+                slot(input.slot);
+                break;
+            }
+            case Expr::Kind::Binary: {
+                const auto& binary = static_cast<const BinaryExpr&>(expr);
+                put(body, static_cast<uint8_t>(binary.op));
+                expression(*binary.left);
+                expression(*binary.right);
+                break;
+            }
+            case Expr::Kind::Compare: {
+                const auto& compare = static_cast<const CompareExpr&>(expr);
+                put(body, static_cast<uint8_t>(compare.op));
+                expression(*compare.left);
+                expression(*compare.right);
+                break;
+            }
+            case Expr::Kind::Array:
+                expressions(static_cast<const ArrayExpr&>(expr).elements);
+                break;
+            case Expr::Kind::Index: {
+                const auto& index = static_cast<const IndexExpr&>(expr);
+                expression(*index.target);
+                expression(*index.index);
+                break;
+            }
+            case Expr::Kind::Builtin: {
+                const auto& call = static_cast<const BuiltinExpr&>(expr);
+                put(body, static_cast<uint8_t>(call.builtin));
+                expressions(call.args);
+                break;
+            }
+        }
+    }
+};
+
+// Decodes what ProgramWriter produced. Any inconsistency throws, and the
+// caller treats the cache as missing. A resolved program is read with the
+// ids its global slots map to.
+class ProgramReader : ByteReader {
+public:
+    explicit ProgramReader(std::string_view payload, const std::vector<uint32_t>* globalIds = nullptr)
+        : ByteReader(payload, "Corrupt program cache."), globalIds(globalIds) {}
+
+    Program read() {
+        tables();
+        Program program;
+        program.statements = block();
+        if (!atEnd()) fail();
+        return program;
+    }
+
+    std::vector<std::shared_ptr<FunctionDef>> readFunctions() {
+        tables();
+        uint32_t count = getIndex();
+        std::vector<std::shared_ptr<FunctionDef>> functions;
+        for (uint32_t i = 0; i < count; ++i) {
+            int line = static_cast<int>(getIndex());
+            functions.push_back(function(line));
+        }
+        if (!atEnd()) fail();
+        return functions;
+    }
+
+private:
+    const std::vector<uint32_t>* globalIds;
+    std::vector<std::string> symbols;
+    std::vector<Value> constants;
+
+    void tables() {
+        uint32_t symbolCount = getIndex();
+        symbols.reserve(symbolCount);
+        for (uint32_t i = 0; i < symbolCount; ++i) {
+            symbols.push_back(getString());
+        }
+
+        uint32_t constantCount = getIndex();
+        constants.reserve(constantCount);
+        for (uint32_t i = 0; i < constantCount; ++i) {
+            switch (static_cast<Value::Type>(get<uint8_t>())) {
+                case Value::Type::Float: constants.push_back(Value::number(get<double>())); break;
+                case Value::Type::Integer: constants.push_back(Value::integer(get<int64_t>())); break;
+                case Value::Type::BigInt: {
+                    Value number;
+                    if (!parseInteger(getString(), number) || !number.isBigInt()) fail();
+                    constants.push_back(std::move(number));
+                    break;
+                }
+                case Value::Type::Boolean: constants.push_back(Value::boolean(get<uint8_t>() != 0)); break;
+                case Value::Type::String: constants.push_back(Value::string(getString())); break;
+                case Value::Type::Array: {
+                    std::vector<double> elements(getIndex());
+                    for (double& element : elements) {
+                        element = get<double>();
+                    }
+                    constants.push_back(Value::array(std::move(elements)));
+                    break;
+                }
+                default: fail();
+            }
+        }
+    }
+
+    Slot slot() {
+        if (!globalIds) return Slot();
+        uint32_t encoded = getIndex();
+        Slot slot{ (encoded & 1) != 0, encoded >> 1 };
+        if (!slot.local) {
+            if (slot.index >= globalIds->size()) fail();
+            slot.index = (*globalIds)[slot.index];
+        }
+        return slot;
+    }
+
+    uint32_t globalSlot() {
+        Slot global = slot();
+        if (global.local) fail();
+        return global.index;
+    }
+
+    const std::string& symbol() {
+        uint32_t id = getIndex();
+        if (id >= symbols.size()) fail();
+        return symbols[id];
+    }
+    const Value& constant() {
+        uint32_t id = getIndex();
+        if (id >= constants.size()) fail();
+        return constants[id];
+    }
+    const std::string& stringConstant() {
+        const Value& value = constant();
+        if (!value.isString()) fail();
+        return value.asString();
+    }
+    std::vector<std::string> names() {
+        uint32_t count = getIndex();
+        std::vector<std::string> list;
+        for (uint32_t i = 0; i < count; ++i) {
+            list.push_back(symbol());
+        }
+        return list;
+    }
+
+    std::shared_ptr<FunctionDef> function(int line) {
+        auto function = std::make_shared<FunctionDef>();
+        function->name = symbol();
+        function->declaredPure = get<uint8_t>() != 0;
+        function->params = names();
+        function->locals = names();
+        if (globalIds) {
+            function->file = stringConstant();
+            function->line = line;
+            function->pure = get<uint8_t>() != 0;
+            function->outputs.resize(getIndex());
+            for (uint32_t& output : function->outputs) {
+                output = globalSlot();
+            }
+            function->inputs.resize(getIndex());
+            for (uint32_t& input : function->inputs) {
+                input = globalSlot();
+            }
+        }
+        function->body = block();
+        return function;
+    }
+
+    Block block() {
+        uint32_t count = getIndex();
+        Block statements;
+        for (uint32_t i = 0; i < count; ++i) {
+            statements.push_back(statement());
+        }
+        return statements;
+    }
+
+    StmtPtr statement() {
+        auto kind = static_cast<Stmt::Kind>(get<uint8_t>());
+        int line = static_cast<int>(getIndex());
+        switch (kind) {
+            case Stmt::Kind::Send:
+                return std::make_unique<SendStmt>(line, expression());
+            case Stmt::Kind::Assign: {
+                std::string name = symbol();
+                Slot target = slot();
+                bool declaration = get<uint8_t>() != 0;
+                auto assign = std::make_unique<AssignStmt>(line, std::move(name), expression(), declaration);
+                assign->slot = target;
+                return assign;
+            }
+            case Stmt::Kind::Call: {
+                auto call = std::make_unique<CallStmt>(line, symbol());
+                call->callee = slot();
+                uint32_t count = getIndex();
+                for (uint32_t i = 0; i < count; ++i) {
+                    call->args.push_back(expression());
+                }
+                return call;
+            }
+            case Stmt::Kind::FuncDef: {
+                Slot target = slot();
+                auto def = std::make_unique<FuncDefStmt>(line, function(line));
+                def->slot = target;
+                return def;
+            }
+            case Stmt::Kind::If: {
+                auto stmt = std::make_unique<IfStmt>(line);
+                uint32_t count = getIndex();
+                for (uint32_t i = 0; i < count; ++i) {
+                    IfBranch branch;
+                    branch.condition = expression();
+                    branch.body = block();
+                    stmt->branches.push_back(std::move(branch));
+                }
+                stmt->elseBody = block();
+                return stmt;
+            }
+            case Stmt::Kind::While: {
+                auto stmt = std::make_unique<WhileStmt>(line, expression());
+                stmt->body = block();
+                return stmt;
+            }
+            case Stmt::Kind::For: {
+                std::string name = symbol();
+                Slot target = slot();
+                ExprPtr start = expression();
+                ExprPtr end = expression();
+                auto stmt = std::make_unique<ForStmt>(line, std::move(name), std::move(start), std::move(end));
+                stmt->slot = target;
+                stmt->body = block();
+                return stmt;
+            }
+            case Stmt::Kind::Run:
+                return std::make_unique<RunStmt>(line, stringConstant());
+            case Stmt::Kind::Import: {
+                std::string path = stringConstant();
+                return std::make_unique<ImportStmt>(line, std::move(path), symbol());
+            }
+            case Stmt::Kind::Exit:
+                return std::make_unique<ExitStmt>(line);
+        }
+        fail();
+    }
+
+    std::vector<ExprPtr> expressions() {
+        uint32_t count = getIndex();
+        std::vector<ExprPtr> list;
+        for (uint32_t i = 0; i < count; ++i) {
+            list.push_back(expression());
+        }
+        return list;
+    }
+
+    ExprPtr expression() {
+        auto kind = static_cast<Expr::Kind>(get<uint8_t>());
+        int line = static_cast<int>(getIndex());
+        switch (kind) {
+            case Expr::Kind::Literal:
+                return std::make_unique<LiteralExpr>(line, constant());
+            case Expr::Kind::Template: {
+                auto tmpl = std::make_unique<TemplateExpr>(line);
+                uint32_t count = getIndex();
+                for (uint32_t i = 0; i < count; ++i) {
+                    bool isVariable = get<uint8_t>() != 0;
+                    const std::string& text = isVariable ? symbol() : stringConstant();
+                    tmpl->parts.push_back({ isVariable, text, isVariable ? slot() : Slot() });
+                }
+                return tmpl;
+            }
+            case Expr::Kind::Variable: {
+                auto variable = std::make_unique<VariableExpr>(line, symbol());
+                variable->slot = slot();
+                return variable;
+            }
+            case Expr::Kind::Input: {
+                auto input = std::make_unique<InputExpr>(line, symbol());
+                input->slot = slot();
+                return input;
+            }
+            case Expr::Kind::Binary: {
+                char op = static_cast<char>(get<uint8_t>());
+                if (op != '+' && op != '-' && op != '*' && op != '/' && op != '^') fail();
+                ExprPtr left = expression();
+                return std::make_unique<BinaryExpr>(line, op, std::move(left), expression());
+            }
+            case Expr::Kind::Compare: {
+                uint8_t op = get<uint8_t>();
+                if (op > static_cast<uint8_t>(CompareOp::GreaterEqual)) fail();
+                ExprPtr left = expression();
+                return std::make_unique<CompareExpr>(line, static_cast<CompareOp>(op), std::move(left), expression());
+            }
+            case Expr::Kind::Array: {
+                auto array = std::make_unique<ArrayExpr>(line);
+                array->elements = expressions();
+                return array;
+            }
+            case Expr::Kind::Index: {
+                ExprPtr target = expression();
+                return std::make_unique<IndexExpr>(line, std::move(target), expression());
+            }
+            case Expr::Kind::Builtin: {
+                uint8_t builtin = get<uint8_t>();
+                if (builtin > static_cast<uint8_t>(Builtin::Dot)) fail();
+                auto call = std::make_unique<BuiltinExpr>(line, static_cast<Builtin>(builtin));
+                call->args = expressions();
+                if (call->args.size() != builtinArity(call->builtin)) fail();
+                return call;
+            }
+        }
+        fail();
+    }
+};
+
+}
+
+std::string encodeFunctions(const std::vector<const FunctionDef*>& functions) {
+    return ProgramWriter(true).write(functions);
+}
+
+std::vector<std::shared_ptr<FunctionDef>> decodeFunctions(std::string_view payload, const std::vector<uint32_t>& globalIds) {
+    return ProgramReader(payload, &globalIds).readFunctions();
+}
+
+bool ProgramCache::load(const std::string& sourcePath, std::string_view source, Program& program) const {
+    try {
+        std::string path = pathFor(sourcePath);
+        if (!std::filesystem::is_regular_file(path)) return false;
+
+        SourceFile file(path);
+        std::string_view contents = file.text();
+        Header header;
+        if (contents.size() < sizeof(header)) return false;
+        std::memcpy(&header, contents.data(), sizeof(header));
+
+        std::string_view payload = contents.substr(sizeof(header));
+        if (std::memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != formatVersion ||
+            header.byteOrder != byteOrderMark || std::memcmp(header.build, buildId, sizeof(buildId)) != 0 ||
+            header.sourceSize != source.size() || header.payloadSize != payload.size() ||
+            header.payloadHash != hashBytes(payload) || header.sourceHash != hashBytes(source)) {
+            return false;
+        }
+
+        program = ProgramReader(payload).read();
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+void ProgramCache::store(const std::string& sourcePath, std::string_view source, const Program& program) const {
+    try {
+        std::string payload = ProgramWriter().write(program);
+        Header header;
+        std::memcpy(header.magic, magic, sizeof(magic));
+        header.version = formatVersion;
+        header.byteOrder = byteOrderMark;
+        std::memcpy(header.build, buildId, sizeof(buildId));
+        header.sourceSize = source.size();
+        header.sourceHash = hashBytes(source);
+        header.payloadSize = payload.size();
+        header.payloadHash = hashBytes(payload);
+
+        std::string path = pathFor(sourcePath);
+        if (!directory.empty()) {
+            std::error_code error;
+            std::filesystem::create_directories(directory, error);
+        }
+
+        replaceFile(path, std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)), payload);
+    } catch (const std::exception&) {
+    }
+}
+
+std::string ProgramCache::pathFor(const std::string& sourcePath) const {
+    if (directory.empty()) return sourcePath + "c";
+
+    // Different scripts may share a file name, so the absolute path picks the
+    // cache file inside the shared directory.
+    std::error_code error;
+    std::filesystem::path absolute = std::filesystem::absolute(sourcePath, error);
+    std::string key = error ? sourcePath : absolute.generic_string();
+    char hash[17];
+    std::snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashBytes(key)));
+    return (std::filesystem::path(directory) / (std::filesystem::path(sourcePath).stem().string() + "-" + hash + ".synzec")).string();
+}
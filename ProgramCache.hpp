@@ -0,0 +1,40 @@
+#ifndef PROGRAMCACHE_HPP
+#define PROGRAMCACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Ast.hpp"
+
+// Stores parsed programs as compact `.synzec` files so later runs of the same
+// script skip lexing and parsing. A cache file records the identifier table,
+// the literal constant pool and the unresolved AST; it is used only when the
+// source hash matches and the same interpreter build wrote it.
+class ProgramCache {
+public:
+    // With no directory, cache files sit next to their sources as `name.synzec`.
+    void setDirectory(std::string directory) { this->directory = std::move(directory); }
+    const std::string& getDirectory() const { return directory; }
+
+    // Returns false, leaving `program` untouched, when there is no usable cache.
+    bool load(const std::string& sourcePath, std::string_view source, Program& program) const;
+    // Best effort: a cache that cannot be written is simply skipped.
+    void store(const std::string& sourcePath, std::string_view source, const Program& program) const;
+
+private:
+    std::string directory;
+
+    std::string pathFor(const std::string& sourcePath) const;
+};
+
+// Resolved, optimized function definitions in the cache file encoding, for
+// snapshots. Every slot and what resolving recorded on each function is kept
+// too. Decoding maps global slots through `globalIds`, the current symbol id
+// for each id the functions were resolved with, and throws
+// std::runtime_error on malformed input.
+std::string encodeFunctions(const std::vector<const FunctionDef*>& functions);
+std::vector<std::shared_ptr<FunctionDef>> decodeFunctions(std::string_view payload, const std::vector<uint32_t>& globalIds);
+
+#endif
@@ -0,0 +1,231 @@
+#include "Purity.hpp"
+#include "ScriptError.hpp"
+#include <algorithm>
+
+namespace {
+
+bool contains(const std::vector<uint32_t>& slots, uint32_t slot) {
+    return std::find(slots.begin(), slots.end(), slot) != slots.end();
+}
+
+// Walks one function body, tracking which globals are assigned on every path
+// to the current statement.
+class PurityCheck {
+public:
+    void function(const FunctionDef& definition) {
+        block(definition.body);
+        for (uint32_t slot : written) {
+            if (!contains(assigned, slot)) {
+                conditional = slot;
+                assignsConditionally = true;
+                break;
+            }
+        }
+    }
+
+    // The first statement that rules the function out, if any.
+    const char* problem = nullptr;
+    int problemLine = 0;
+    // Globals read before the function assigned them, in first-read order.
+    std::vector<uint32_t> inputs;
+    bool assignsConditionally = false;
+    uint32_t conditional = 0;
+    // Globals assigned on every path so far, and globals assigned on any path.
+    std::vector<uint32_t> assigned;
+    std::vector<uint32_t> written;
+
+private:
+    void fail(int line, const char* reason) {
+        if (problem) return;
+        problem = reason;
+        problemLine = line;
+    }
+
+    void write(Slot slot) {
+        if (slot.local) return;
+        if (!contains(assigned, slot.index)) assigned.push_back(slot.index);
+        if (!contains(written, slot.index)) written.push_back(slot.index);
+    }
+
+    void read(Slot slot) {
+        if (!slot.local && !contains(assigned, slot.index) && !contains(inputs, slot.index)) inputs.push_back(slot.index);
+    }
+
+    void block(const Block& statements) {
+        for (const StmtPtr& stmt : statements) {
+            statement(*stmt);
+        }
+    }
+
+    // Runs `body` from the current state and keeps only the globals that the
+    // previous alternatives assigned too.
+    void alternative(const Block& body, const std::vector<uint32_t>& before, std::vector<uint32_t>& common, bool first) {
+        assigned = before;
+        block(body);
+        if (first) {
+            common = assigned;
+        } else {
+            common.erase(std::remove_if(common.begin(), common.end(),
+                                        [this](uint32_t slot) { return !contains(assigned, slot); }),
+                         common.end());
+        }
+    }
+
+    void statement(const Stmt& stmt) {
+        switch (stmt.kind) {
+            case Stmt::Kind::Send:
+                fail(stmt.line, "uses send");
+                break;
+            case Stmt::Kind::Assign: {
+                const auto& assign = static_cast<const AssignStmt&>(stmt);
+                expression(*assign.value);
+                write(assign.slot);
+                break;
+            }
+            case Stmt::Kind::Call:
+                fail(stmt.line, "calls a function");
+                break;
+            case Stmt::Kind::FuncDef:
+                fail(stmt.line, "defines a function");
+                break;
+            case Stmt::Kind::If: {
+                const auto& ifStmt = static_cast<const IfStmt&>(stmt);
+                std::vector<uint32_t> before = assigned;
+                std::vector<uint32_t> common;
+                for (size_t i = 0; i < ifStmt.branches.size(); ++i) {
+                    assigned = before;
+                    expression(*ifStmt.branches[i].condition);
+                    alternative(ifStmt.branches[i].body, before, common, i == 0);
+                }
+                alternative(ifStmt.elseBody, before, common, ifStmt.branches.empty());
+                assigned = std::move(common);
+                break;
+            }
+            case Stmt::Kind::While: {
+                // The body may not run at all, so only what was assigned before it counts.
+                const auto& whileStmt = static_cast<const WhileStmt&>(stmt);
+                std::vector<uint32_t> before = assigned;
+                expression(*whileStmt.condition);
+                block(whileStmt.body);
+                assigned = std::move(before);
+                break;
+            }
+            case Stmt::Kind::For: {
+                const auto& forStmt = static_cast<const ForStmt&>(stmt);
+                expression(*forStmt.start);
+                expression(*forStmt.end);
+                std::vector<uint32_t> before = assigned;
+                write(forStmt.slot);
+                block(forStmt.body);
+                assigned = std::move(before);
+                break;
+            }
+            case Stmt::Kind::Run:
+                fail(stmt.line, "runs a file");
+                break;
+            case Stmt::Kind::Import:
+                fail(stmt.line, "imports a module");
+                break;
+            case Stmt::Kind::Exit:
+                fail(stmt.line, "uses exit");
+                break;
+        }
+    }
+
+    void expression(const Expr& expr) {
+        switch (expr.kind) {
+            case Expr::Kind::Literal:
+                break;
+            case Expr::Kind::Template:
+                for (const TemplatePart& part : static_cast<const TemplateExpr&>(expr).parts) {
+                    if (part.isVariable) read(part.slot);
+                }
+                break;
+            case Expr::Kind::Variable:
+                read(static_cast<const VariableExpr&>(expr).slot);
+                break;
+            case Expr::Kind::Input:
+                fail(expr.line, "reads input");
+                break;
+            case Expr::Kind::Binary: {
+                const auto& binary = static_cast<const BinaryExpr&>(expr);
+                expression(*binary.left);
+                expression(*binary.right);
+                break;
+            }
+            case Expr::Kind::Compare: {
+                const auto& compare = static_cast<const CompareExpr&>(expr);
+                expression(*compare.left);
+                expression(*compare.right);
+                break;
+            }
+            case Expr::Kind::Array:
+                for (const ExprPtr& element : static_cast<const ArrayExpr&>(expr).elements) {
+                    expression(*element);
+                }
+                break;
+            case Expr::Kind::Index: {
+                const auto& index = static_cast<const IndexExpr&>(expr);
+                expression(*index.target);
+                expression(*index.index);
+                break;
+            }
+            case Expr::Kind::Builtin:
+                for (const ExprPtr& arg : static_cast<const BuiltinExpr&>(expr).args) {
+                    expression(*arg);
+                }
+                break;
+        }
+    }
+};
+
+void markFunction(FunctionDef& definition, const SymbolTable& symbols) {
+    PurityCheck check;
+    check.function(definition);
+    definition.pure = !check.problem && !check.assignsConditionally && (check.inputs.empty() || definition.declaredPure);
+    if (definition.pure) {
+        definition.outputs = std::move(check.written);
+        definition.inputs = std::move(check.inputs);
+    } else if (check.problem && definition.declaredPure) {
+        throw ScriptError(check.problemLine,
+                          "Function '" + definition.name + "' is declared pure but " + check.problem + ".");
+    } else if (definition.declaredPure) {
+        throw ScriptError(definition.line, "Function '" + definition.name + "' is declared pure but does not assign '" +
+                                               symbols.name(check.conditional) + "' on every path.");
+    }
+}
+
+void markBlock(Block& block, const SymbolTable& symbols) {
+    for (StmtPtr& stmt : block) {
+        switch (stmt->kind) {
+            case Stmt::Kind::FuncDef: {
+                FunctionDef& definition = *static_cast<FuncDefStmt&>(*stmt).function;
+                markFunction(definition, symbols);
+                markBlock(definition.body, symbols);
+                break;
+            }
+            case Stmt::Kind::If: {
+                auto& ifStmt = static_cast<IfStmt&>(*stmt);
+                for (IfBranch& branch : ifStmt.branches) {
+                    markBlock(branch.body, symbols);
+                }
+                markBlock(ifStmt.elseBody, symbols);
+                break;
+            }
+            case Stmt::Kind::While:
+                markBlock(static_cast<WhileStmt&>(*stmt).body, symbols);
+                break;
+            case Stmt::Kind::For:
+                markBlock(static_cast<ForStmt&>(*stmt).body, symbols);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+}
+
+void markPureFunctions(Program& program, const SymbolTable& symbols) {
+    markBlock(program.statements, symbols);
+}
@@ -0,0 +1,16 @@
+#ifndef PURITY_HPP
+#define PURITY_HPP
+
+#include "Ast.hpp"
+#include "SymbolTable.hpp"
+
+// Finds the functions in a resolved program whose calls can be memoized and
+// sets FunctionDef::pure and outputs on them. Such a function does not send,
+// read input, call functions, run or import files, or exit; it reads only its
+// locals and the globals it has already assigned; and it assigns the same
+// globals on every path through its body. A function written `pure func` may
+// also read other globals, whose values then join the arguments in the cache
+// key (FunctionDef::inputs); if it breaks any other rule, a ScriptError says why.
+void markPureFunctions(Program& program, const SymbolTable& symbols);
+
+#endif
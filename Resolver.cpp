@@ -0,0 +1,187 @@
+#include "Resolver.hpp"
+#include <algorithm>
+
+void Resolver::resolve(Program& program) {
+    function = nullptr;
+    if (!module.empty()) {
+        moduleNames.clear();
+        collectModuleNames(program.statements);
+        function = nullptr;
+    }
+    resolve(program.statements);
+}
+
+void Resolver::collectModuleName(const std::string& name) {
+    if (function && std::find(function->locals.begin(), function->locals.end(), name) != function->locals.end()) return;
+    moduleNames.insert(name);
+}
+
+void Resolver::collectModuleNames(const Block& block) {
+    for (const StmtPtr& stmt : block) {
+        switch (stmt->kind) {
+            case Stmt::Kind::Assign:
+                collectModuleName(static_cast<const AssignStmt&>(*stmt).name);
+                break;
+            case Stmt::Kind::FuncDef: {
+                const FunctionDef* definition = static_cast<const FuncDefStmt&>(*stmt).function.get();
+                collectModuleName(definition->name);
+                const FunctionDef* enclosing = function;
+                function = definition;
+                collectModuleNames(definition->body);
+                function = enclosing;
+                break;
+            }
+            case Stmt::Kind::If: {
+                const auto& ifStmt = static_cast<const IfStmt&>(*stmt);
+                for (const IfBranch& branch : ifStmt.branches) {
+                    collectModuleNames(branch.body);
+                }
+                collectModuleNames(ifStmt.elseBody);
+                break;
+            }
+            case Stmt::Kind::While:
+                collectModuleNames(static_cast<const WhileStmt&>(*stmt).body);
+                break;
+            case Stmt::Kind::For: {
+                const auto& forStmt = static_cast<const ForStmt&>(*stmt);
+                collectModuleName(forStmt.name);
+                collectModuleNames(forStmt.body);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void Resolver::resolve(Block& block) {
+    for (StmtPtr& stmt : block) {
+        resolve(*stmt);
+    }
+}
+
+void Resolver::resolve(Stmt& stmt) {
+    switch (stmt.kind) {
+        case Stmt::Kind::Send:
+            resolve(*static_cast<SendStmt&>(stmt).value);
+            break;
+        case Stmt::Kind::Assign: {
+            auto& assign = static_cast<AssignStmt&>(stmt);
+            resolve(*assign.value);
+            assign.slot = slotFor(assign.name);
+            break;
+        }
+        case Stmt::Kind::Call: {
+            auto& call = static_cast<CallStmt&>(stmt);
+            for (ExprPtr& arg : call.args) {
+                resolve(*arg);
+            }
+            call.callee = slotFor(call.name);
+            break;
+        }
+        case Stmt::Kind::FuncDef: {
+            auto& def = static_cast<FuncDefStmt&>(stmt);
+            def.slot = slotFor(def.function->name);
+            def.function->file = file;
+            def.function->line = stmt.line;
+
+            const FunctionDef* enclosing = function;
+            function = def.function.get();
+            resolve(def.function->body);
+            function = enclosing;
+            break;
+        }
+        case Stmt::Kind::If: {
+            auto& ifStmt = static_cast<IfStmt&>(stmt);
+            for (IfBranch& branch : ifStmt.branches) {
+                resolve(*branch.condition);
+                resolve(branch.body);
+            }
+            resolve(ifStmt.elseBody);
+            break;
+        }
+        case Stmt::Kind::While: {
+            auto& whileStmt = static_cast<WhileStmt&>(stmt);
+            resolve(*whileStmt.condition);
+            resolve(whileStmt.body);
+            break;
+        }
+        case Stmt::Kind::For: {
+            auto& forStmt = static_cast<ForStmt&>(stmt);
+            resolve(*forStmt.start);
+            resolve(*forStmt.end);
+            forStmt.slot = slotFor(forStmt.name);
+            resolve(forStmt.body);
+            break;
+        }
+        case Stmt::Kind::Run:
+        case Stmt::Kind::Import:
+        case Stmt::Kind::Exit:
+            break;
+    }
+}
+
+void Resolver::resolve(Expr& expr) {
+    switch (expr.kind) {
+        case Expr::Kind::Literal:
+            break;
+        case Expr::Kind::Template:
+            for (TemplatePart& part : static_cast<TemplateExpr&>(expr).parts) {
+                if (part.isVariable) part.slot = slotFor(part.text);
+            }
+            break;
+        case Expr::Kind::Variable: {
+            auto& variable = static_cast<VariableExpr&>(expr);
+            variable.slot = slotFor(variable.name);
+            break;
+        }
+        case Expr::Kind::Input: {
+            auto& input = static_cast<InputExpr&>(expr);
+            if (!input.target.empty()) input.slot = slotFor(input.target);
+            break;
+        }
+        case Expr::Kind::Binary: {
+            auto& binary = static_cast<BinaryExpr&>(expr);
+            resolve(*binary.left);
+            resolve(*binary.right);
+            break;
+        }
+        case Expr::Kind::Compare: {
+            auto& compare = static_cast<CompareExpr&>(expr);
+            resolve(*compare.left);
+            resolve(*compare.right);
+            break;
+        }
+        case Expr::Kind::Array:
+            for (ExprPtr& element : static_cast<ArrayExpr&>(expr).elements) {
+                resolve(*element);
+            }
+            break;
+        case Expr::Kind::Index: {
+            auto& index = static_cast<IndexExpr&>(expr);
+            resolve(*index.target);
+            resolve(*index.index);
+            break;
+        }
+        case Expr::Kind::Builtin:
+            for (ExprPtr& arg : static_cast<BuiltinExpr&>(expr).args) {
+                resolve(*arg);
+            }
+            break;
+    }
+}
+
+Slot Resolver::slotFor(const std::string& name) {
+    if (function) {
+        const auto& locals = function->locals;
+        for (size_t i = 0; i < locals.size(); ++i) {
+            if (locals[i] == name) return { true, static_cast<uint32_t>(i) };
+        }
+    }
+    if (!module.empty() && name.find('.') == std::string::npos) {
+        std::string qualified = module + '.' + name;
+        uint32_t id;
+        if (moduleNames.count(name) > 0 || symbols.find(qualified, id)) return { false, symbols.intern(qualified) };
+    }
+    return { false, symbols.intern(name) };
+}
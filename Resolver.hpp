@@ -0,0 +1,37 @@
+#ifndef RESOLVER_HPP
+#define RESOLVER_HPP
+
+#include <string>
+#include <unordered_set>
+#include "Ast.hpp"
+#include "SymbolTable.hpp"
+
+// Binds every name in a parsed program to a slot, so neither engine looks
+// names up by string while running. In a module, global names without a dot
+// are bound under `module.` if the module assigns or defines them (or an
+// earlier part of it did); other names, such as host natives, refer to the
+// global of that name. Dotted names always refer to the global itself.
+class Resolver {
+public:
+    explicit Resolver(SymbolTable& symbols, std::string file = std::string(), std::string module = std::string())
+        : symbols(symbols), file(std::move(file)), module(std::move(module)) {}
+
+    void resolve(Program& program);
+
+private:
+    SymbolTable& symbols;
+    std::string file;
+    std::string module;
+    const FunctionDef* function = nullptr;
+    // Undotted names the module assigns or defines as globals.
+    std::unordered_set<std::string> moduleNames;
+
+    void collectModuleNames(const Block& block);
+    void collectModuleName(const std::string& name);
+    void resolve(Block& block);
+    void resolve(Stmt& stmt);
+    void resolve(Expr& expr);
+    Slot slotFor(const std::string& name);
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SCRIPT_ERROR_HPP
+#define SCRIPT_ERROR_HPP
+
+#include <stdexcept>
+#include <string>
+
+// An error tied to the script line that caused it. Errors raised while a
+// function runs also name the file the function came from, which may not be
+// the file being run.
+class ScriptError : public std::runtime_error {
+public:
+    ScriptError(int line, const std::string& message, std::string file = std::string())
+        : std::runtime_error(message), line_(line), file_(std::move(file)) {}
+
+    int line() const { return line_; }
+    const std::string& file() const { return file_; }
+
+private:
+    int line_;
+    std::string file_;
+};
+
+#endif
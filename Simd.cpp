@@ -0,0 +1,216 @@
+#include "Simd.hpp"
+#include <atomic>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define SYNZE_X86_64 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SYNZE_TARGET_AVX2
+#else
+#define SYNZE_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+// Every class provides a scalar membership test and, on x86-64, 16- and
+// 32-byte versions that set the bytes belonging to the class.
+struct Blanks {
+    static bool member(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+#ifdef SYNZE_X86_64
+    static __m128i match16(__m128i v) {
+        return _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+                            _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')));
+    }
+    SYNZE_TARGET_AVX2 static __m256i match32(__m256i v) {
+        return _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+                               _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')));
+    }
+#endif
+};
+
+struct IdentifierChars {
+    static bool member(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+    }
+#ifdef SYNZE_X86_64
+    // Setting bit 5 folds upper case onto lower case without letting '@' or '['
+    // into the range. Bytes above 0x7F compare as negative and never match.
+    static __m128i match16(__m128i v) {
+        __m128i folded = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        __m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(folded, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(folded, _mm_set1_epi8('z' + 1)));
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        return _mm_or_si128(_mm_or_si128(alpha, digit), _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }
+    SYNZE_TARGET_AVX2 static __m256i match32(__m256i v) {
+        __m256i folded = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        __m256i alpha = _mm256_and_si256(_mm256_cmpgt_epi8(folded, _mm256_set1_epi8('a' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), folded));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        return _mm256_or_si256(_mm256_or_si256(alpha, digit), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('_')));
+    }
+#endif
+};
+
+struct DigitChars {
+    static bool member(char c) { return (c >= '0' && c <= '9') || c == '.'; }
+#ifdef SYNZE_X86_64
+    static __m128i match16(__m128i v) {
+        __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(v, _mm_set1_epi8('9' + 1)));
+        return _mm_or_si128(digit, _mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    }
+    SYNZE_TARGET_AVX2 static __m256i match32(__m256i v) {
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('0' - 1)),
+                                         _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), v));
+        return _mm256_or_si256(digit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+    }
+#endif
+};
+
+struct StringChars {
+    static bool member(char c) { return c != '"' && c != '\\' && c != '\n'; }
+#ifdef SYNZE_X86_64
+    static __m128i match16(__m128i v) {
+        __m128i stop = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))),
+                                    _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+        return _mm_xor_si128(stop, _mm_set1_epi8(-1));
+    }
+    SYNZE_TARGET_AVX2 static __m256i match32(__m256i v) {
+        __m256i stop = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))),
+                                       _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+        return _mm256_xor_si256(stop, _mm256_set1_epi8(-1));
+    }
+#endif
+};
+
+template <typename Class>
+size_t scanScalar(const char* data, size_t from, size_t size) {
+    while (from < size && Class::member(data[from])) ++from;
+    return from;
+}
+
+#ifdef SYNZE_X86_64
+unsigned countTrailingZeros(uint32_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward(&index, value);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(value));
+#endif
+}
+
+template <typename Class>
+size_t scanSse2(const char* data, size_t from, size_t size) {
+    while (from + 16 <= size) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + from));
+        uint32_t inside = static_cast<uint32_t>(_mm_movemask_epi8(Class::match16(chunk)));
+        if (inside != 0xFFFFu) return from + countTrailingZeros(~inside);
+        from += 16;
+    }
+    return scanScalar<Class>(data, from, size);
+}
+
+template <typename Class>
+SYNZE_TARGET_AVX2 size_t scanAvx2(const char* data, size_t from, size_t size) {
+    while (from + 32 <= size) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + from));
+        uint32_t inside = static_cast<uint32_t>(_mm256_movemask_epi8(Class::match32(chunk)));
+        if (inside != 0xFFFFFFFFu) return from + countTrailingZeros(~inside);
+        from += 32;
+    }
+    return scanSse2<Class>(data, from, size);
+}
+#endif
+
+using ScanFunction = size_t (*)(const char*, size_t, size_t);
+
+struct Scanners {
+    ScanFunction blanks;
+    ScanFunction identifier;
+    ScanFunction digits;
+    ScanFunction stringBody;
+};
+
+const Scanners scalarScanners = { scanScalar<Blanks>, scanScalar<IdentifierChars>, scanScalar<DigitChars>, scanScalar<StringChars> };
+#ifdef SYNZE_X86_64
+const Scanners sse2Scanners = { scanSse2<Blanks>, scanSse2<IdentifierChars>, scanSse2<DigitChars>, scanSse2<StringChars> };
+const Scanners avx2Scanners = { scanAvx2<Blanks>, scanAvx2<IdentifierChars>, scanAvx2<DigitChars>, scanAvx2<StringChars> };
+#endif
+
+const Scanners& scannersFor(SimdLevel level) {
+#ifdef SYNZE_X86_64
+    if (level == SimdLevel::AVX2) return avx2Scanners;
+    if (level == SimdLevel::SSE2) return sse2Scanners;
+#endif
+    (void)level;
+    return scalarScanners;
+}
+
+// Process-wide. Atomic so that lexing on other threads stays well defined if
+// the level is changed while they run.
+std::atomic<SimdLevel> activeLevel{ detectSimdLevel() };
+std::atomic<const Scanners*> active{ &scannersFor(activeLevel.load()) };
+
+}
+
+SimdLevel detectSimdLevel() {
+#ifdef SYNZE_X86_64
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] >= 7) {
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        __cpuidex(info, 7, 0);
+        bool avx2 = (info[1] & (1 << 5)) != 0;
+        if (osxsave && avx2 && (_xgetbv(0) & 6) == 6) return SimdLevel::AVX2;
+    }
+    return SimdLevel::SSE2;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? SimdLevel::AVX2 : SimdLevel::SSE2;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+SimdLevel getSimdLevel() {
+    return activeLevel.load(std::memory_order_relaxed);
+}
+
+void setSimdLevel(SimdLevel level) {
+    SimdLevel supported = detectSimdLevel();
+    if (static_cast<int>(level) > static_cast<int>(supported)) level = supported;
+    activeLevel.store(level, std::memory_order_relaxed);
+    active.store(&scannersFor(level), std::memory_order_relaxed);
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Scalar: return "scalar";
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+    }
+    return "unknown";
+}
+
+size_t skipBlanks(const char* data, size_t from, size_t size) {
+    return active.load(std::memory_order_relaxed)->blanks(data, from, size);
+}
+
+size_t scanIdentifier(const char* data, size_t from, size_t size) {
+    return active.load(std::memory_order_relaxed)->identifier(data, from, size);
+}
+
+size_t scanDigits(const char* data, size_t from, size_t size) {
+    return active.load(std::memory_order_relaxed)->digits(data, from, size);
+}
+
+size_t scanStringBody(const char* data, size_t from, size_t size) {
+    return active.load(std::memory_order_relaxed)->stringBody(data, from, size);
+}
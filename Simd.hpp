@@ -0,0 +1,24 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstddef>
+
+// Vectorised byte scanners for the lexer. The widest level the CPU supports is
+// picked at startup; every level returns exactly what the scalar loop would.
+enum class SimdLevel { Scalar, SSE2, AVX2 };
+
+SimdLevel detectSimdLevel();
+SimdLevel getSimdLevel();
+// Clamped to what the CPU supports. The level is shared by every interpreter
+// in the process.
+void setSimdLevel(SimdLevel level);
+const char* simdLevelName(SimdLevel level);
+
+// Each scanner returns the index of the first byte at or after `from` that is
+// outside its class, or `size` if the buffer ends first.
+size_t skipBlanks(const char* data, size_t from, size_t size);      // ' ', '\t', '\r'
+size_t scanIdentifier(const char* data, size_t from, size_t size);  // [A-Za-z0-9_]
+size_t scanDigits(const char* data, size_t from, size_t size);      // [0-9.]
+size_t scanStringBody(const char* data, size_t from, size_t size);  // up to '"', '\\' or '\n'
+
+#endif
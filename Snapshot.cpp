@@ -0,0 +1,195 @@
+#include "Snapshot.hpp"
+#include "Encoding.hpp"
+#include "ProgramCache.hpp"
+#include "SourceFile.hpp"
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// Bump whenever this layout or the program encoding changes. Snapshots from
+// another build are refused as well.
+const uint32_t formatVersion = 3;
+const uint32_t byteOrderMark = 0x01020304;
+const char magic[8] = { 'S', 'Y', 'N', 'Z', 'E', 'S', 0, 0 };
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    char build[32];
+    uint64_t payloadSize;
+    uint64_t payloadHash;
+};
+
+// Payload layout: the symbol table in id order, the function definitions,
+// the globals (a function as its index among the definitions), then the
+// imported modules.
+std::string writePayload(const SymbolTable& symbols, const Snapshot& snapshot) {
+    std::string out;
+    putIndex(out, static_cast<uint32_t>(symbols.size()));
+    for (uint32_t id = 0; id < symbols.size(); ++id) {
+        putString(out, symbols.name(id));
+    }
+
+    // Globals holding the same function object share one definition.
+    std::vector<const FunctionDef*> functions;
+    std::unordered_map<const FunctionObject*, uint32_t> functionIds;
+    for (const Snapshot::Global& global : snapshot.globals) {
+        if (!global.value.isFunction()) continue;
+        const FunctionObject& function = global.value.asFunction();
+        if (!function.definition) throw std::runtime_error("Cannot save native function '" + symbols.name(global.id) + "'.");
+        if (functionIds.emplace(&function, static_cast<uint32_t>(functions.size())).second) {
+            functions.push_back(function.definition.get());
+        }
+    }
+    putString(out, encodeFunctions(functions));
+
+    putIndex(out, static_cast<uint32_t>(snapshot.globals.size()));
+    for (const Snapshot::Global& global : snapshot.globals) {
+        const Value& value = global.value;
+        putIndex(out, global.id);
+        put(out, static_cast<uint8_t>(value.type()));
+        switch (value.type()) {
+            case Value::Type::Undefined: break;
+            case Value::Type::Float: put(out, value.asNumber()); break;
+            case Value::Type::Integer: put(out, value.asInteger()); break;
+            case Value::Type::BigInt: putString(out, value.toString()); break;
+            case Value::Type::Boolean: put(out, static_cast<uint8_t>(value.asBoolean())); break;
+            case Value::Type::String: putString(out, value.asString()); break;
+            case Value::Type::Function: putIndex(out, functionIds.at(&value.asFunction())); break;
+            case Value::Type::Array:
+                putIndex(out, static_cast<uint32_t>(value.asArray().size()));
+                for (double element : value.asArray()) {
+                    put(out, element);
+                }
+                break;
+        }
+    }
+
+    putIndex(out, static_cast<uint32_t>(snapshot.modules.size()));
+    for (const Snapshot::Module& module : snapshot.modules) {
+        putString(out, module.path);
+        put(out, module.modified);
+        putIndex(out, static_cast<uint32_t>(module.names.size()));
+        for (const std::string& name : module.names) {
+            putString(out, name);
+        }
+    }
+    return out;
+}
+
+// Decodes against the ids the saved names will have once interned, and
+// interns them only after the whole payload has been read, so a bad payload
+// leaves `symbols` unchanged. New names get consecutive ids in saved order,
+// exactly as interning them in that order does.
+Snapshot readPayload(std::string_view payload, SymbolTable& symbols) {
+    ByteReader in(payload, "Corrupt snapshot.");
+    std::vector<std::string> names(in.getIndex());
+    std::vector<uint32_t> ids(names.size());
+    std::unordered_map<std::string_view, uint32_t> newIds;
+    for (size_t i = 0; i < names.size(); ++i) {
+        names[i] = in.getString();
+        if (symbols.find(names[i], ids[i])) continue;
+        ids[i] = static_cast<uint32_t>(symbols.size() + newIds.size());
+        // A name saved twice would end up with one id, not two.
+        if (!newIds.emplace(names[i], ids[i]).second) in.fail();
+    }
+
+    std::vector<Value> functions;
+    for (std::shared_ptr<FunctionDef>& definition : decodeFunctions(in.getString(), ids)) {
+        functions.push_back(Value::function(std::move(definition)));
+    }
+
+    Snapshot snapshot;
+    snapshot.globals.resize(in.getIndex());
+    for (Snapshot::Global& global : snapshot.globals) {
+        uint32_t id = in.getIndex();
+        if (id >= ids.size()) in.fail();
+        global.id = ids[id];
+        switch (static_cast<Value::Type>(in.get<uint8_t>())) {
+            case Value::Type::Undefined: break;
+            case Value::Type::Float: global.value = Value::number(in.get<double>()); break;
+            case Value::Type::Integer: global.value = Value::integer(in.get<int64_t>()); break;
+            case Value::Type::BigInt:
+                if (!parseInteger(in.getString(), global.value) || !global.value.isBigInt()) in.fail();
+                break;
+            case Value::Type::Boolean: global.value = Value::boolean(in.get<uint8_t>() != 0); break;
+            case Value::Type::String: global.value = Value::string(in.getString()); break;
+            case Value::Type::Function: {
+                uint32_t index = in.getIndex();
+                if (index >= functions.size()) in.fail();
+                global.value = functions[index];
+                break;
+            }
+            case Value::Type::Array: {
+                std::vector<double> elements(in.getIndex());
+                for (double& element : elements) {
+                    element = in.get<double>();
+                }
+                global.value = Value::array(std::move(elements));
+                break;
+            }
+            default: in.fail();
+        }
+    }
+
+    snapshot.modules.resize(in.getIndex());
+    for (Snapshot::Module& module : snapshot.modules) {
+        module.path = in.getString();
+        module.modified = in.get<int64_t>();
+        module.names.resize(in.getIndex());
+        for (std::string& name : module.names) {
+            name = in.getString();
+        }
+    }
+    if (!in.atEnd()) in.fail();
+
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (ids[i] >= symbols.size()) symbols.intern(names[i]);
+    }
+    return snapshot;
+}
+
+}
+
+void writeSnapshot(const std::string& path, const SymbolTable& symbols, const Snapshot& snapshot) {
+    std::string payload = writePayload(symbols, snapshot);
+    Header header;
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = formatVersion;
+    header.byteOrder = byteOrderMark;
+    std::memcpy(header.build, buildId, sizeof(buildId));
+    header.payloadSize = payload.size();
+    header.payloadHash = hashBytes(payload);
+
+    if (!replaceFile(path, std::string_view(reinterpret_cast<const char*>(&header), sizeof(header)), payload)) {
+        throw std::runtime_error("Unable to write snapshot: " + path);
+    }
+}
+
+Snapshot readSnapshot(const std::string& path, SymbolTable& symbols) {
+    if (!std::filesystem::is_regular_file(path)) throw std::runtime_error("Unable to open snapshot: " + path);
+    SourceFile file(path);
+    std::string_view contents = file.text();
+    Header header;
+    if (contents.size() < sizeof(header)) throw std::runtime_error("Not a snapshot: " + path);
+    std::memcpy(&header, contents.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) throw std::runtime_error("Not a snapshot: " + path);
+    if (header.version != formatVersion || header.byteOrder != byteOrderMark ||
+        std::memcmp(header.build, buildId, sizeof(buildId)) != 0) {
+        throw std::runtime_error("Snapshot was saved by another build of the interpreter: " + path);
+    }
+
+    std::string_view payload = contents.substr(sizeof(header));
+    if (header.payloadSize != payload.size() || header.payloadHash != hashBytes(payload)) {
+        throw std::runtime_error("Corrupt snapshot: " + path);
+    }
+    try {
+        return readPayload(payload, symbols);
+    } catch (const std::runtime_error&) {
+        throw std::runtime_error("Corrupt snapshot: " + path);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "SymbolTable.hpp"
+#include "Value.hpp"
+
+// An interpreter state saved after a prelude has run, so later processes can
+// start from it instead of running the prelude again. Functions are kept as
+// resolved, optimized definitions; the VM compiles them on first call as usual.
+struct Snapshot {
+    struct Global {
+        uint32_t id;
+        Value value;
+    };
+    // An imported file, with its modification time as a file clock tick count.
+    struct Module {
+        std::string path;
+        int64_t modified;
+        std::vector<std::string> names;
+    };
+    std::vector<Global> globals;
+    std::vector<Module> modules;
+};
+
+// Writes the whole symbol table and the given state, which must not hold
+// native functions. Throws std::runtime_error if the file cannot be written.
+void writeSnapshot(const std::string& path, const SymbolTable& symbols, const Snapshot& snapshot);
+// Maps the file, checks its checksum and the build that wrote it, and interns
+// the saved names into `symbols`, which may already hold others; the returned
+// globals use ids from `symbols`. Throws std::runtime_error if the file is
+// missing, corrupt or from another build.
+Snapshot readSnapshot(const std::string& path, SymbolTable& symbols);
+
+#endif
@@ -0,0 +1,124 @@
+#include "SourceFile.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define SYNZE_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+SourceFile::SourceFile(const std::string& path) {
+    if (!map(path)) read(path);
+}
+
+SourceFile::~SourceFile() {
+    if (!mapped) return;
+#if defined(_WIN32)
+    UnmapViewOfFile(data);
+    CloseHandle(mapping);
+#elif defined(SYNZE_HAS_MMAP)
+    munmap(const_cast<char*>(data), size);
+#endif
+}
+
+bool SourceFile::map(const std::string& path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    // Empty files cannot be mapped; they fall through to the buffered path.
+    if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+
+    const void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        CloseHandle(mapping);
+        mapping = nullptr;
+        return false;
+    }
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    mapped = true;
+    return true;
+#elif defined(SYNZE_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (view == MAP_FAILED) return false;
+
+    madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(view);
+    size = static_cast<size_t>(info.st_size);
+    mapped = true;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif
+}
+
+void SourceFile::read(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open file: " + path);
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    buffer = contents.str();
+    data = buffer.data();
+    size = buffer.size();
+}
+
+namespace {
+
+bool startsTopLevelStatement(std::string_view source, size_t pos) {
+    char c = source[pos];
+    if (c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '#') return false;
+    // `else` continues the if chain above it.
+    if (source.compare(pos, 4, "else") == 0) {
+        size_t next = pos + 4;
+        if (next == source.size()) return false;
+        char after = source[next];
+        bool identifier = (after >= 'a' && after <= 'z') || (after >= 'A' && after <= 'Z') || (after >= '0' && after <= '9') || after == '_';
+        return identifier;
+    }
+    return true;
+}
+
+}
+
+size_t nextChunkEnd(std::string_view source, size_t start, size_t budget) {
+    if (source.size() - start <= budget) return source.size();
+
+    size_t pos = source.find('\n', start + budget);
+    while (pos != std::string_view::npos) {
+        ++pos;
+        if (pos == source.size() || startsTopLevelStatement(source, pos)) return pos;
+        pos = source.find('\n', pos);
+    }
+    return source.size();
+}
@@ -0,0 +1,40 @@
+#ifndef SOURCEFILE_HPP
+#define SOURCEFILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Read-only contents of a script file. The file is memory-mapped where the
+// platform allows it; otherwise (pipes, unsupported systems) it is read into
+// a single buffer.
+class SourceFile {
+public:
+    explicit SourceFile(const std::string& path);
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+    SourceFile& operator=(const SourceFile&) = delete;
+
+    std::string_view text() const { return { data, size }; }
+    bool isMapped() const { return mapped; }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool mapped = false;
+    std::string buffer;
+#ifdef _WIN32
+    void* mapping = nullptr;
+#endif
+
+    bool map(const std::string& path);
+    void read(const std::string& path);
+};
+
+// Returns where a chunk starting at `start` should end so that it holds about
+// `budget` bytes. Chunks only end right before a top-level statement, so a
+// function body or an if/else chain is never split.
+size_t nextChunkEnd(std::string_view source, size_t start, size_t budget);
+
+#endif
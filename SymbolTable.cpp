@@ -0,0 +1,11 @@
+#include "SymbolTable.hpp"
+
+uint32_t SymbolTable::intern(const std::string& name) {
+    auto found = ids.find(name);
+    if (found != ids.end()) return found->second;
+
+    uint32_t id = static_cast<uint32_t>(names.size());
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
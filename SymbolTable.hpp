@@ -0,0 +1,29 @@
+#ifndef SYMBOL_TABLE_HPP
+#define SYMBOL_TABLE_HPP
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Interns identifier names. A name's id never changes, so it doubles as the
+// name's global slot.
+class SymbolTable {
+public:
+    uint32_t intern(const std::string& name);
+    // Sets `id` and returns true if the name has been interned.
+    bool find(const std::string& name, uint32_t& id) const {
+        auto found = ids.find(name);
+        if (found == ids.end()) return false;
+        id = found->second;
+        return true;
+    }
+    const std::string& name(uint32_t id) const { return names[id]; }
+    size_t size() const { return names.size(); }
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+};
+
+#endif
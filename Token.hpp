@@ -1,7 +1,7 @@
 #ifndef TOKEN_HPP
 #define TOKEN_HPP
 
-#include <string>
+#include <cstdint>
 
 enum TokenType {
     NUMBER,
@@ -13,17 +13,25 @@ enum TokenType {
     RUN,
     VARIABLE,
     EXIT,
-    COMMENT,
     FUNC,
     IF,
-    ELSE_IF,
-    ELSE,  
-    INVALID
+    ELSE,
+    WHILE,
+    FOR,
+    IN,
+    IMPORT,
+    PURE
 };
 
+// A token refers back into the source buffer instead of owning its text. For
+// string literals the range covers the raw body between the quotes; escapes
+// are decoded by the parser.
 struct Token {
     TokenType type;
-    std::string value;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t line;
+    uint32_t column;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,294 @@
+#include "VM.hpp"
+#include "Compiler.hpp"
+#include "Interpreter.hpp"
+#include "ScriptError.hpp"
+#include <stdexcept>
+
+void VM::run(const Chunk& entry) {
+    size_t baseFrame = frames.size();
+    size_t baseStack = stack.size();
+    frames.push_back({ &entry, nullptr, nullptr, 0, baseStack });
+
+    Interpreter::Scope scope;
+    const Chunk* chunk = &entry;
+    size_t ip = 0;
+
+    try {
+        for (;;) {
+            const Instruction& instruction = chunk->code[ip++];
+            switch (instruction.op) {
+                case OpCode::PushConstant:
+                    stack.push_back(chunk->constants[instruction.operand]);
+                    break;
+                case OpCode::LoadLocal: {
+                    const Value& value = stack[scope.base + instruction.operand];
+                    if (!value.isDefined()) interpreter.undefinedVariable(scope, { true, static_cast<uint32_t>(instruction.operand) });
+                    stack.push_back(value);
+                    break;
+                }
+                case OpCode::LoadGlobal: {
+                    const Value& value = interpreter.globals[instruction.operand];
+                    if (!value.isDefined()) interpreter.undefinedVariable(scope, { false, static_cast<uint32_t>(instruction.operand) });
+                    stack.push_back(value);
+                    break;
+                }
+                case OpCode::StoreLocal:
+                    stack[scope.base + instruction.operand] = std::move(stack.back());
+                    stack.pop_back();
+                    break;
+                case OpCode::StoreGlobal:
+                    interpreter.globals[instruction.operand] = std::move(stack.back());
+                    stack.pop_back();
+                    break;
+                case OpCode::ReadInput:
+                    stack.push_back(Interpreter::parseInput(interpreter.readLine()));
+                    break;
+                case OpCode::ReadLine:
+                    stack.push_back(Value::string(interpreter.readLine()));
+                    break;
+                case OpCode::Interpolate: {
+                    std::string text;
+                    interpreter.interpolate(scope, chunk->templates[instruction.operand]->parts, text);
+                    stack.push_back(Value::string(std::move(text)));
+                    break;
+                }
+                case OpCode::MakeArray: {
+                    size_t first = stack.size() - instruction.operand;
+                    Value array = Interpreter::makeArray(stack.data() + first, instruction.operand);
+                    stack.resize(first);
+                    stack.push_back(std::move(array));
+                    break;
+                }
+                case OpCode::Index: {
+                    Value index = std::move(stack.back());
+                    stack.pop_back();
+                    stack.back() = Interpreter::indexArray(stack.back(), index);
+                    break;
+                }
+                case OpCode::CallBuiltin: {
+                    size_t first = stack.size() - instruction.count;
+                    Value result = Interpreter::callBuiltin(static_cast<Builtin>(instruction.operand), stack.data() + first);
+                    stack.resize(first);
+                    stack.push_back(std::move(result));
+                    break;
+                }
+                case OpCode::Add:
+                case OpCode::Subtract:
+                case OpCode::Multiply:
+                case OpCode::Divide:
+                case OpCode::Power: {
+                    static const char operators[] = { '+', '-', '*', '/', '^' };
+                    char op = operators[static_cast<int>(instruction.op) - static_cast<int>(OpCode::Add)];
+                    Value right = std::move(stack.back());
+                    stack.pop_back();
+                    Value& left = stack.back();
+                    int64_t result;
+                    if (left.isInteger() && right.isInteger() &&
+                        ((op == '+' && checkedAdd(left.asInteger(), right.asInteger(), result)) ||
+                         (op == '-' && checkedSubtract(left.asInteger(), right.asInteger(), result)) ||
+                         (op == '*' && checkedMultiply(left.asInteger(), right.asInteger(), result)))) {
+                        left = Value::integer(result);
+                    } else {
+                        left = Interpreter::applyOperator(op, left, right);
+                    }
+                    break;
+                }
+                case OpCode::Equal:
+                case OpCode::NotEqual:
+                case OpCode::Less:
+                case OpCode::Greater:
+                case OpCode::LessEqual:
+                case OpCode::GreaterEqual: {
+                    auto op = static_cast<CompareOp>(static_cast<int>(instruction.op) - static_cast<int>(OpCode::Equal));
+                    Value right = std::move(stack.back());
+                    stack.pop_back();
+                    stack.back() = Interpreter::compareValues(op, stack.back(), right);
+                    break;
+                }
+                case OpCode::Jump:
+                    ip = instruction.operand;
+                    break;
+                case OpCode::JumpIfFalse: {
+                    bool condition = stack.back().isTruthy();
+                    stack.pop_back();
+                    if (!condition) ip = instruction.operand;
+                    break;
+                }
+                case OpCode::ForPrepare:
+                    Interpreter::checkRange(stack[stack.size() - 2], stack.back());
+                    break;
+                case OpCode::ForTest: {
+                    const Value& counter = stack[stack.size() - 2];
+                    if (Interpreter::rangeContinues(counter, stack.back())) {
+                        stack.push_back(counter);
+                    } else {
+                        ip = instruction.operand;
+                    }
+                    break;
+                }
+                case OpCode::ForNext: {
+                    Value& counter = stack[stack.size() - 2];
+                    counter = Interpreter::nextInRange(counter);
+                    ip = instruction.operand;
+                    break;
+                }
+                case OpCode::Pop:
+                    stack.resize(stack.size() - instruction.count);
+                    break;
+                case OpCode::Send:
+                    interpreter.sendOutput(stack.back());
+                    stack.pop_back();
+                    break;
+                case OpCode::SendTemplate:
+                    interpreter.interpolate(scope, chunk->templates[instruction.operand]->parts, interpreter.output->buffer());
+                    interpreter.output->endLine();
+                    break;
+                case OpCode::CallLocal:
+                case OpCode::CallGlobal: {
+                    Slot callee = { instruction.op == OpCode::CallLocal, static_cast<uint32_t>(instruction.operand) };
+                    frames.back().ip = ip;
+                    call(callee, instruction.count, scope, chunk, ip);
+                    break;
+                }
+                case OpCode::TailCallLocal:
+                case OpCode::TailCallGlobal: {
+                    Slot callee = { instruction.op == OpCode::TailCallLocal, static_cast<uint32_t>(instruction.operand) };
+                    tailCall(callee, instruction.count, scope, chunk, ip);
+                    break;
+                }
+                case OpCode::Return: {
+                    if (frames.size() - 1 == baseFrame) {
+                        frames.pop_back();
+                        return;
+                    }
+                    stack.erase(stack.begin() + frames.back().base, stack.end());
+                    frames.pop_back();
+                    --interpreter.callDepth;
+                    if (interpreter.profiler) interpreter.profiler->exitFunction();
+                    if (interpreter.pendingMemo.table) interpreter.finishMemoCall();
+
+                    const Frame& caller = frames.back();
+                    scope = { caller.function.get(), &stack, caller.base };
+                    chunk = caller.chunk;
+                    ip = caller.ip;
+                    break;
+                }
+                case OpCode::DefineFunction: {
+                    const ChunkFunction& function = chunk->functions[instruction.operand];
+                    interpreter.defineFunction(scope, function.slot, function.definition);
+                    break;
+                }
+                case OpCode::Run:
+                    interpreter.runFile(chunk->constants[instruction.operand].asString());
+                    break;
+                case OpCode::Import:
+                    interpreter.importModule(chunk->constants[instruction.operand].asString(),
+                                             chunk->constants[instruction.operand + 1].asString());
+                    break;
+                case OpCode::Exit:
+                    interpreter.handleExit();
+                    break;
+                case OpCode::Line:
+                    interpreter.profiler->line(instruction.operand);
+                    break;
+            }
+        }
+    } catch (const ScriptError&) {
+        unwind(baseFrame, baseStack);
+        throw;
+    } catch (const Interpreter::ExitRequest&) {
+        unwind(baseFrame, baseStack);
+        throw;
+    } catch (const std::exception& e) {
+        int line = chunk->lines[ip - 1];
+        std::string file = scope.function ? scope.function->file : std::string();
+        unwind(baseFrame, baseStack);
+        throw ScriptError(line, e.what(), std::move(file));
+    }
+}
+
+const FunctionObject& VM::prepare(Slot slot, size_t argCount, const Interpreter::Scope& scope) {
+    const FunctionObject& callee = interpreter.lookupFunction(scope, slot, argCount);
+    if (!callee.bytecode && !callee.native) {
+        callee.bytecode = Compiler(interpreter.profiler != nullptr).compileFunction(*callee.definition);
+    }
+    return callee;
+}
+
+void VM::call(Slot slot, size_t argCount, Interpreter::Scope& scope, const Chunk*& chunk, size_t& ip) {
+    const FunctionObject& callee = prepare(slot, argCount, scope);
+    if (callee.native) {
+        std::shared_ptr<const NativeFunction> native = callee.native;
+        interpreter.callNative(*native, stack.data() + stack.size() - argCount, argCount);
+        stack.resize(stack.size() - argCount);
+        return;
+    }
+    if (interpreter.memoizes(callee) && interpreter.beginMemoCall(callee, stack.data() + stack.size() - argCount, argCount)) {
+        stack.resize(stack.size() - argCount);
+        return;
+    }
+    std::shared_ptr<const Chunk> body = callee.bytecode;
+    std::shared_ptr<const FunctionDef> function = callee.definition;
+
+    if (interpreter.callDepth >= interpreter.maxCallDepth) interpreter.callDepthExceeded(trace());
+    ++interpreter.callDepth;
+    if (interpreter.profiler) interpreter.profiler->enterFunction(function);
+    size_t base = stack.size() - argCount;
+    stack.resize(base + function->locals.size());
+
+    scope = { function.get(), &stack, base };
+    chunk = body.get();
+    ip = 0;
+    frames.push_back({ chunk, std::move(body), std::move(function), 0, base });
+}
+
+void VM::tailCall(Slot slot, size_t argCount, Interpreter::Scope& scope, const Chunk*& chunk, size_t& ip) {
+    const FunctionObject& callee = prepare(slot, argCount, scope);
+    // A native call runs in place, and a memoized call needs its own frame so
+    // its return can be seen; neither replaces the caller.
+    if (callee.native || interpreter.memoizes(callee)) {
+        frames.back().ip = ip;
+        call(slot, argCount, scope, chunk, ip);
+        return;
+    }
+    std::shared_ptr<const Chunk> body = callee.bytecode;
+    std::shared_ptr<const FunctionDef> function = callee.definition;
+
+    if (interpreter.profiler) {
+        interpreter.profiler->exitFunction();
+        interpreter.profiler->enterFunction(function);
+    }
+    // The arguments replace the caller's locals; the remaining locals start out undefined.
+    Frame& frame = frames.back();
+    std::move(stack.end() - argCount, stack.end(), stack.begin() + frame.base);
+    stack.resize(frame.base + argCount);
+    stack.resize(frame.base + function->locals.size());
+
+    scope = { function.get(), &stack, frame.base };
+    chunk = body.get();
+    ip = 0;
+    frame.chunk = chunk;
+    frame.owner = std::move(body);
+    frame.function = std::move(function);
+}
+
+std::vector<Interpreter::TraceEntry> VM::trace() const {
+    std::vector<Interpreter::TraceEntry> entries;
+    for (size_t i = frames.size(); i-- > 0;) {
+        if (frames[i].function) entries.push_back({ frames[i].function.get(), frames[i].chunk->lines[frames[i].ip - 1] });
+    }
+    return entries;
+}
+
+void VM::unwind(size_t baseFrame, size_t baseStack) {
+    size_t calls = frames.size() - baseFrame - 1;
+    interpreter.callDepth -= calls;
+    if (interpreter.profiler) {
+        for (size_t i = 0; i < calls; ++i) {
+            interpreter.profiler->exitFunction();
+        }
+    }
+    frames.erase(frames.begin() + baseFrame, frames.end());
+    stack.erase(stack.begin() + baseStack, stack.end());
+    interpreter.pendingMemo = Interpreter::PendingMemo();
+}
@@ -0,0 +1,39 @@
+#ifndef VM_HPP
+#define VM_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "Bytecode.hpp"
+#include "Interpreter.hpp"
+
+// Runs compiled chunks on a value stack. Script calls push a frame instead of
+// recursing, and tail calls reuse it; a frame's locals are the slots between
+// its base and the stack top.
+class VM {
+public:
+    explicit VM(Interpreter& interpreter) : interpreter(interpreter) {}
+
+    void run(const Chunk& chunk);
+
+private:
+    struct Frame {
+        const Chunk* chunk;
+        std::shared_ptr<const Chunk> owner;
+        std::shared_ptr<const FunctionDef> function;
+        size_t ip;
+        size_t base;
+    };
+
+    Interpreter& interpreter;
+    std::vector<Value> stack;
+    std::vector<Frame> frames;
+
+    void call(Slot slot, size_t argCount, Interpreter::Scope& scope, const Chunk*& chunk, size_t& ip);
+    void tailCall(Slot slot, size_t argCount, Interpreter::Scope& scope, const Chunk*& chunk, size_t& ip);
+    const FunctionObject& prepare(Slot slot, size_t argCount, const Interpreter::Scope& scope);
+    std::vector<Interpreter::TraceEntry> trace() const;
+    void unwind(size_t baseFrame, size_t baseStack);
+};
+
+#endif
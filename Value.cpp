@@ -0,0 +1,278 @@
+#include "Value.hpp"
+#include "Ast.hpp"
+#include "Native.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+// Shorter results are copied into one flat string; a rope node would cost
+// more than the copy.
+const size_t ropeThreshold = 256;
+
+template <typename T>
+int orderOf(const T& left, const T& right) {
+    return left < right ? -1 : left > right ? 1 : 0;
+}
+
+// An Integer or BigInt against a float that is not NaN. The float's whole
+// part is compared exactly, then its fraction breaks a tie.
+int compareWithFloat(const Value& exact, double value) {
+    if (std::isinf(value)) return value > 0 ? -1 : 1;
+    double whole = std::trunc(value);
+    int order;
+    if (exact.isInteger() && std::fabs(whole) < 9223372036854775808.0) {
+        order = orderOf(exact.asInteger(), static_cast<int64_t>(whole));
+    } else {
+        order = BigInt::compare(exact.toBigInt(), BigInt::fromWhole(whole));
+    }
+    return order != 0 ? order : orderOf(whole, value);
+}
+
+}
+
+StringObject::StringObject(StringObject* left, StringObject* right)
+    : length(left->length + right->length), left(left), right(right) {
+    ++left->refCount;
+    ++right->refCount;
+}
+
+StringObject::~StringObject() {
+    if (left) releaseParts();
+}
+
+void StringObject::flatten() const {
+    std::string result;
+    result.reserve(length);
+    // In-order walk with an explicit stack; ropes built by appending in a
+    // loop are as deep as the number of appends.
+    std::vector<const StringObject*> pending{ this };
+    while (!pending.empty()) {
+        const StringObject* node = pending.back();
+        pending.pop_back();
+        if (node->left) {
+            pending.push_back(node->right);
+            pending.push_back(node->left);
+        } else {
+            result += node->text;
+        }
+    }
+    text = std::move(result);
+    releaseParts();
+}
+
+void StringObject::releaseParts() const {
+    std::vector<StringObject*> pending{ left, right };
+    left = right = nullptr;
+    while (!pending.empty()) {
+        StringObject* node = pending.back();
+        pending.pop_back();
+        if (--node->refCount > 0) continue;
+        if (node->left) {
+            pending.push_back(node->left);
+            pending.push_back(node->right);
+            node->left = node->right = nullptr;
+        }
+        delete node;
+    }
+}
+
+Value Value::string(std::string text) {
+    Value result;
+    result.type_ = Type::String;
+    result.object_ = new StringObject(std::move(text));
+    return result;
+}
+
+Value Value::concatenate(const Value& left, const Value& right) {
+    if (!left.isString()) return concatenate(string(left.toString()), right);
+    if (!right.isString()) return concatenate(left, string(right.toString()));
+    if (left.stringLength() + right.stringLength() < ropeThreshold) {
+        std::string text;
+        text.reserve(left.stringLength() + right.stringLength());
+        text += left.asString();
+        text += right.asString();
+        return string(std::move(text));
+    }
+    if (right.stringLength() == 0) return left;
+    if (left.stringLength() == 0) return right;
+
+    Value result;
+    result.type_ = Type::String;
+    result.object_ = new StringObject(static_cast<StringObject*>(left.object_), static_cast<StringObject*>(right.object_));
+    return result;
+}
+
+Value Value::bigInt(BigInt value) {
+    if (value.fitsInt64()) return integer(value.toInt64());
+    Value result;
+    result.type_ = Type::BigInt;
+    result.object_ = new BigIntObject(std::move(value));
+    return result;
+}
+
+Value Value::function(std::shared_ptr<const FunctionDef> definition) {
+    Value result;
+    result.type_ = Type::Function;
+    result.object_ = new FunctionObject(std::move(definition));
+    return result;
+}
+
+Value Value::native(std::shared_ptr<const NativeFunction> function) {
+    Value result;
+    result.type_ = Type::Function;
+    result.object_ = new FunctionObject(std::move(function));
+    return result;
+}
+
+Value Value::array(std::vector<double> elements) {
+    Value result;
+    result.type_ = Type::Array;
+    result.object_ = new ArrayObject(std::move(elements));
+    return result;
+}
+
+const char* Value::typeName() const {
+    switch (type_) {
+        case Type::Undefined: return "undefined";
+        case Type::Float:
+        case Type::Integer:
+        case Type::BigInt: return "number";
+        case Type::Boolean: return "boolean";
+        case Type::String: return "string";
+        case Type::Function: return "function";
+        case Type::Array: return "array";
+    }
+    return "unknown";
+}
+
+bool Value::isTruthy() const {
+    switch (type_) {
+        case Type::Undefined: return false;
+        case Type::Float: return number_ != 0;
+        case Type::Integer: return integer_ != 0;
+        case Type::BigInt: return true;
+        case Type::Boolean: return boolean_;
+        case Type::String: return stringLength() > 0;
+        case Type::Function: return true;
+        case Type::Array: return !asArray().empty();
+    }
+    return false;
+}
+
+bool Value::equals(const Value& other) const {
+    if (isNumber() && other.isNumber() && (isFloat() || other.isFloat())) {
+        int order;
+        return compareNumbers(*this, other, order) && order == 0;
+    }
+    if (type_ != other.type_) return false;
+    switch (type_) {
+        case Type::Undefined: return true;
+        case Type::Float: return number_ == other.number_;
+        case Type::Integer: return integer_ == other.integer_;
+        case Type::BigInt: return BigInt::compare(asBigInt(), other.asBigInt()) == 0;
+        case Type::Boolean: return boolean_ == other.boolean_;
+        case Type::String: return stringLength() == other.stringLength() && asString() == other.asString();
+        case Type::Function: return object_ == other.object_;
+        case Type::Array: return asArray() == other.asArray();
+    }
+    return false;
+}
+
+bool Value::compareNumbers(const Value& left, const Value& right, int& order) {
+    if (left.isFloat() && right.isFloat()) {
+        if (std::isnan(left.number_) || std::isnan(right.number_)) return false;
+        order = orderOf(left.number_, right.number_);
+    } else if (left.isFloat() || right.isFloat()) {
+        double value = left.isFloat() ? left.number_ : right.number_;
+        if (std::isnan(value)) return false;
+        order = left.isFloat() ? -compareWithFloat(right, value) : compareWithFloat(left, value);
+    } else if (left.isInteger() && right.isInteger()) {
+        order = orderOf(left.integer_, right.integer_);
+    } else {
+        order = BigInt::compare(left.toBigInt(), right.toBigInt());
+    }
+    return true;
+}
+
+void Value::appendTo(std::string& out) const {
+    switch (type_) {
+        case Type::Undefined:
+            out += "undefined";
+            break;
+        case Type::Float:
+            appendNumber(out, number_);
+            break;
+        case Type::Integer: {
+            char buffer[24];
+            auto result = std::to_chars(buffer, buffer + sizeof(buffer), integer_);
+            out.append(buffer, result.ptr);
+            break;
+        }
+        case Type::BigInt:
+            asBigInt().appendTo(out);
+            break;
+        case Type::Boolean:
+            out += boolean_ ? "true" : "false";
+            break;
+        case Type::String:
+            out += asString();
+            break;
+        case Type::Function:
+            if (asFunction().native) {
+                out += "<native ";
+                out += asFunction().native->name;
+            } else {
+                out += "<func ";
+                out += asFunction().definition->name;
+            }
+            out += '>';
+            break;
+        case Type::Array: {
+            const std::vector<double>& elements = asArray();
+            out += '[';
+            for (size_t i = 0; i < elements.size(); ++i) {
+                if (i > 0) out += ", ";
+                appendNumber(out, elements[i]);
+            }
+            out += ']';
+            break;
+        }
+    }
+}
+
+std::string Value::toString() const {
+    if (type_ == Type::String) return asString();
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+// Whole numbers that a double holds exactly print as integers; everything else
+// prints as the shortest text that reads back as the same double.
+void appendNumber(std::string& out, double value) {
+    char buffer[32];
+    std::to_chars_result result;
+    const double exactLimit = 9007199254740992.0;  // 2^53
+    if (value > -exactLimit && value < exactLimit && static_cast<double>(static_cast<int64_t>(value)) == value) {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), static_cast<int64_t>(value));
+    } else {
+        result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    }
+    out.append(buffer, static_cast<size_t>(result.ptr - buffer));
+}
+
+bool parseInteger(std::string_view text, Value& result) {
+    int64_t value = 0;
+    auto parsed = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (parsed.ptr != text.data() + text.size()) return false;
+    if (parsed.ec == std::errc()) {
+        result = Value::integer(value);
+        return true;
+    }
+    BigInt big;
+    if (parsed.ec != std::errc::result_out_of_range || !BigInt::parse(text, big)) return false;
+    result = Value::bigInt(std::move(big));
+    return true;
+}
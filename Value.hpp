@@ -0,0 +1,202 @@
+#ifndef VALUE_HPP
+#define VALUE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BigInt.hpp"
+
+struct Chunk;
+struct FunctionDef;
+struct NativeFunction;
+class MemoTable;
+
+// Base of reference-counted value payloads. Counts are not atomic: a value
+// belongs to one interpreter.
+struct HeapObject {
+    virtual ~HeapObject() = default;
+
+    uint32_t refCount = 1;
+};
+
+// A string is either flat text or the concatenation of two other strings,
+// which makes `+` O(1) for long strings. A concatenation is flattened the
+// first time its text is needed and then drops its parts.
+struct StringObject : HeapObject {
+    explicit StringObject(std::string text) : length(text.size()), text(std::move(text)) {}
+    // Takes a reference to both parts.
+    StringObject(StringObject* left, StringObject* right);
+    ~StringObject() override;
+
+    const std::string& flat() const {
+        if (left) flatten();
+        return text;
+    }
+
+    size_t length;
+
+private:
+    mutable std::string text;
+    mutable StringObject* left = nullptr;
+    mutable StringObject* right = nullptr;
+
+    void flatten() const;
+    // Releases both parts without recursing, however deep the rope is.
+    void releaseParts() const;
+};
+
+struct ArrayObject : HeapObject {
+    explicit ArrayObject(std::vector<double> elements) : elements(std::move(elements)) {}
+
+    std::vector<double> elements;
+};
+
+struct BigIntObject : HeapObject {
+    explicit BigIntObject(BigInt value) : value(std::move(value)) {}
+
+    BigInt value;
+};
+
+struct FunctionObject : HeapObject {
+    explicit FunctionObject(std::shared_ptr<const FunctionDef> definition) : definition(std::move(definition)) {}
+    explicit FunctionObject(std::shared_ptr<const NativeFunction> native) : native(std::move(native)) {}
+
+    // A script function has a definition; a host function registered with
+    // Interpreter::defineNative() has `native` instead.
+    std::shared_ptr<const FunctionDef> definition;
+    std::shared_ptr<const NativeFunction> native;
+    // Compiled by the VM on first call.
+    mutable std::shared_ptr<const Chunk> bytecode;
+    // Cached calls, created on the first call if the function is pure.
+    mutable std::shared_ptr<MemoTable> memo;
+};
+
+// A Synze value. Numbers and booleans are stored inline, so copying them never
+// allocates; strings, arrays, functions and big integers share an immutable,
+// reference-counted payload.
+//
+// A number is an Integer (int64) while it is whole and fits, a BigInt once an
+// integer result overflows, and a Float when it has a fraction. BigInts are
+// always outside the int64 range, so equal integers have the same type.
+class Value {
+public:
+    // Undefined marks a declared slot that has not been assigned yet.
+    enum class Type : uint8_t { Undefined, Float, Boolean, String, Function, Array, Integer, BigInt };
+
+    Value() : type_(Type::Undefined), bits_(0) {}
+    Value(const Value& other) : type_(other.type_), bits_(other.bits_) { retain(); }
+    Value(Value&& other) noexcept : type_(other.type_), bits_(other.bits_) { other.type_ = Type::Undefined; }
+    ~Value() { release(); }
+
+    Value& operator=(const Value& other) {
+        if (this != &other) {
+            other.retain();
+            release();
+            type_ = other.type_;
+            bits_ = other.bits_;
+        }
+        return *this;
+    }
+    Value& operator=(Value&& other) noexcept {
+        if (this != &other) {
+            release();
+            type_ = other.type_;
+            bits_ = other.bits_;
+            other.type_ = Type::Undefined;
+        }
+        return *this;
+    }
+
+    static Value number(double value) {
+        Value result;
+        result.type_ = Type::Float;
+        result.number_ = value;
+        return result;
+    }
+    static Value integer(int64_t value) {
+        Value result;
+        result.type_ = Type::Integer;
+        result.integer_ = value;
+        return result;
+    }
+    // Stored as an Integer when the value fits.
+    static Value bigInt(BigInt value);
+    static Value boolean(bool value) {
+        Value result;
+        result.type_ = Type::Boolean;
+        result.boolean_ = value;
+        return result;
+    }
+    static Value string(std::string text);
+    // `left + right` where at least one side is a string.
+    static Value concatenate(const Value& left, const Value& right);
+    static Value function(std::shared_ptr<const FunctionDef> definition);
+    static Value native(std::shared_ptr<const NativeFunction> function);
+    static Value array(std::vector<double> elements);
+
+    Type type() const { return type_; }
+    bool isDefined() const { return type_ != Type::Undefined; }
+    bool isNumber() const { return type_ == Type::Float || type_ == Type::Integer || type_ == Type::BigInt; }
+    bool isFloat() const { return type_ == Type::Float; }
+    bool isInteger() const { return type_ == Type::Integer; }
+    bool isBigInt() const { return type_ == Type::BigInt; }
+    bool isBoolean() const { return type_ == Type::Boolean; }
+    bool isString() const { return type_ == Type::String; }
+    bool isFunction() const { return type_ == Type::Function; }
+    bool isArray() const { return type_ == Type::Array; }
+
+    // Any number, converted to a double.
+    double asNumber() const {
+        return type_ == Type::Integer ? static_cast<double>(integer_) : type_ == Type::Float ? number_ : asBigInt().toDouble();
+    }
+    int64_t asInteger() const { return integer_; }
+    const BigInt& asBigInt() const { return static_cast<const BigIntObject*>(object_)->value; }
+    // An Integer or BigInt as a BigInt.
+    BigInt toBigInt() const { return type_ == Type::Integer ? BigInt(integer_) : asBigInt(); }
+    bool asBoolean() const { return boolean_; }
+    // Flattens a concatenated string on first use.
+    const std::string& asString() const { return static_cast<const StringObject*>(object_)->flat(); }
+    size_t stringLength() const { return static_cast<const StringObject*>(object_)->length; }
+    const FunctionObject& asFunction() const { return *static_cast<const FunctionObject*>(object_); }
+    const std::vector<double>& asArray() const { return static_cast<const ArrayObject*>(object_)->elements; }
+
+    const char* typeName() const;
+    bool isTruthy() const;
+    bool equals(const Value& other) const;
+    // Orders two numbers by their exact values, so a large integer and the
+    // float nearest to it are not equal. Returns false if either is NaN.
+    static bool compareNumbers(const Value& left, const Value& right, int& order);
+
+    // Text conversion happens only when a value is printed or concatenated.
+    void appendTo(std::string& out) const;
+    std::string toString() const;
+
+private:
+    Type type_;
+    union {
+        double number_;
+        int64_t integer_;
+        bool boolean_;
+        HeapObject* object_;
+        uint64_t bits_;
+    };
+
+    bool isHeap() const {
+        return type_ == Type::String || type_ == Type::Function || type_ == Type::Array || type_ == Type::BigInt;
+    }
+    void retain() const {
+        if (isHeap()) ++object_->refCount;
+    }
+    void release() {
+        if (isHeap() && --object_->refCount == 0) delete object_;
+    }
+};
+
+void appendNumber(std::string& out, double value);
+// Parses decimal digits with an optional '-' as an Integer, or as a BigInt
+// when the value does not fit. Returns false for anything else.
+bool parseInteger(std::string_view text, Value& result);
+
+#endif
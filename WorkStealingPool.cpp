@@ -0,0 +1,73 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct WorkQueue {
+    std::mutex mutex;
+    std::deque<size_t> items;
+};
+
+bool takeOwn(WorkQueue& queue, size_t& item) {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.items.empty()) return false;
+    item = queue.items.front();
+    queue.items.pop_front();
+    return true;
+}
+
+bool steal(std::vector<WorkQueue>& queues, size_t self, size_t& item) {
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkQueue& victim = queues[(self + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            item = victim.items.back();
+            victim.items.pop_back();
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+void WorkStealingPool::run(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+
+    size_t workers = std::min<size_t>(threads, count);
+    std::vector<WorkQueue> queues(workers);
+    for (size_t i = 0; i < count; ++i) {
+        queues[i * workers / count].items.push_back(i);
+    }
+
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    // No work is added once running, so a worker that finds every queue empty
+    // is finished.
+    auto work = [&](size_t self) {
+        size_t item;
+        while (takeOwn(queues[self], item) || steal(queues, self, item)) {
+            try {
+                task(item);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure) failure = std::current_exception();
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t worker = 1; worker < workers; ++worker) {
+        pool.emplace_back(work, worker);
+    }
+    work(0);
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (failure) std::rethrow_exception(failure);
+}
@@ -0,0 +1,22 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <cstddef>
+#include <functional>
+
+// Runs a fixed set of indexed tasks on worker threads. Each worker starts with
+// its own contiguous share of the indexes and takes from the front of it; once
+// that is empty it steals from the back of another worker's share.
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(unsigned threads) : threads(threads == 0 ? 1 : threads) {}
+
+    // Calls task(i) once for every i in [0, count) and returns when all calls
+    // are done. The first exception a task throws is rethrown afterwards.
+    void run(size_t count, const std::function<void(size_t)>& task);
+
+private:
+    unsigned threads;
+};
+
+#endif
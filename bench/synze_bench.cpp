@@ -0,0 +1,303 @@
+// Microbenchmarks and example-derived workloads for the interpreter. Results
+// are printed as JSON so they can be compared between releases:
+//
+//   synze_bench [--engine=tree|vm] [--filter=text] [--min-time=ms] [--fixtures=dir]
+//
+// Script workloads are timed per statement (or per call, chain or file) and
+// include lexing and parsing, as a real `run` would.
+
+#include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Simd.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+#ifndef SYNZE_SOURCE_DIR
+#define SYNZE_SOURCE_DIR "."
+#endif
+
+static std::atomic<size_t> allocationCount{ 0 };
+
+void* operator new(size_t size) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size == 0 ? 1 : size)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    std::free(memory);
+}
+
+namespace {
+
+struct Options {
+    Interpreter::Engine engine = Interpreter::Engine::VM;
+    std::string filter;
+    double minMilliseconds = 300;
+    std::filesystem::path fixtures = std::filesystem::path(SYNZE_SOURCE_DIR) / "bench" / "fixtures";
+};
+
+struct Result {
+    std::string name;
+    size_t ops = 0;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    double mbPerSecond = 0;
+    long peakRssKb = 0;
+};
+
+long peakRssKb() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return static_cast<long>(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
+
+// Calls `body` until at least the minimum time has passed. Each call counts as
+// `opsPerCall` operations.
+Result measure(const Options& options, const std::string& name, size_t opsPerCall, const std::function<void()>& body) {
+    body();
+
+    size_t calls = 0;
+    size_t allocations = allocationCount.load();
+    auto start = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::milli> elapsed(0);
+    do {
+        body();
+        ++calls;
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < options.minMilliseconds);
+
+    Result result;
+    result.name = name;
+    result.ops = calls * opsPerCall;
+    result.nsPerOp = elapsed.count() * 1e6 / static_cast<double>(result.ops);
+    result.allocsPerOp = static_cast<double>(allocationCount.load() - allocations) / static_cast<double>(result.ops);
+    result.peakRssKb = peakRssKb();
+    return result;
+}
+
+void writeFile(const std::filesystem::path& path, const std::string& text) {
+    std::ofstream(path, std::ios::binary) << text;
+}
+
+std::string readFile(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("Unable to open " + path.string());
+    }
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    return contents.str();
+}
+
+// Runs a script in a fresh interpreter with captured output and the given
+// input. `setup`, if given, prepares the interpreter first.
+void runScript(const Options& options, const std::string& path, const std::string& input = "", bool cache = false,
+               const std::function<void(Interpreter&)>& setup = nullptr) {
+    StringSink output;
+    StringSink errors;
+    output.setFlushPolicy(OutputSink::FlushPolicy::Exit);
+    errors.setFlushPolicy(OutputSink::FlushPolicy::Exit);
+    std::istringstream stdinFixture(input);
+
+    Interpreter interpreter;
+    interpreter.setEngine(options.engine);
+    interpreter.setCacheEnabled(cache);
+    interpreter.setOutputSink(output);
+    interpreter.setErrorSink(errors);
+    interpreter.setInputStream(stdinFixture);
+    if (setup) setup(interpreter);
+    interpreter.handleRunCommand(path);
+}
+
+std::string repeat(const std::string& line, size_t count) {
+    std::string text;
+    text.reserve(line.size() * count);
+    for (size_t i = 0; i < count; ++i) {
+        text += line;
+    }
+    return text;
+}
+
+std::string generatedProgram(size_t lines) {
+    std::string text;
+    for (size_t i = 0; i < lines; ++i) {
+        switch (i % 4) {
+            case 0: text += "value" + std::to_string(i) + " = " + std::to_string(i) + " + 3 * 2.5\n"; break;
+            case 1: text += "send \"line {value" + std::to_string(i - 1) + "} of the generated script\"\n"; break;
+            case 2: text += "if value" + std::to_string(i - 2) + " > 100\n"; break;
+            case 3: text += "    send value" + std::to_string(i - 3) + " - 1 # comment\n"; break;
+        }
+    }
+    return text;
+}
+
+void printJson(const Options& options, const std::vector<Result>& results) {
+    std::printf("{\n");
+    std::printf("  \"engine\": \"%s\",\n", options.engine == Interpreter::Engine::VM ? "vm" : "tree");
+    std::printf("  \"simd\": \"%s\",\n", simdLevelName(getSimdLevel()));
+    std::printf("  \"peak_rss_kb\": %ld,\n", peakRssKb());
+    std::printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& result = results[i];
+        std::printf("    { \"name\": \"%s\", \"ops\": %zu, \"ns_per_op\": %.1f, \"allocs_per_op\": %.2f, ",
+                    result.name.c_str(), result.ops, result.nsPerOp, result.allocsPerOp);
+        if (result.mbPerSecond > 0) std::printf("\"mb_per_s\": %.1f, ", result.mbPerSecond);
+        std::printf("\"peak_rss_kb\": %ld }%s\n", result.peakRssKb, i + 1 < results.size() ? "," : "");
+    }
+    std::printf("  ]\n}\n");
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=tree") {
+            options.engine = Interpreter::Engine::Tree;
+        } else if (arg == "--engine=vm") {
+            options.engine = Interpreter::Engine::VM;
+        } else if (arg.rfind("--filter=", 0) == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.rfind("--min-time=", 0) == 0) {
+            options.minMilliseconds = std::atof(arg.c_str() + 11);
+        } else if (arg.rfind("--fixtures=", 0) == 0) {
+            options.fixtures = arg.substr(11);
+        } else {
+            std::cerr << "Usage: synze_bench [--engine=tree|vm] [--filter=text] [--min-time=ms] [--fixtures=dir]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::filesystem::path work = std::filesystem::temp_directory_path() /
+                                 ("synze_bench_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+    std::filesystem::create_directories(work);
+    auto script = [&work](const std::string& name, const std::string& text) {
+        std::string path = (work / (name + ".synze")).generic_string();
+        writeFile(path, text);
+        return path;
+    };
+
+    const size_t lines = 2000;
+    std::string lexSource = generatedProgram(40000);
+    std::string arithmetic = script("arithmetic", repeat("send 1 + 2 * 3 - 4 / 5 ^ 2\n", lines));
+    std::string interpolation = script("interpolation", "name = \"World\"\nage = 42\n" +
+                                       repeat("send \"Hello {name}, you are {age} years old\"\n", lines));
+    std::string chains = script("chains", "x = 4\n" + repeat("if x == 1\n    send 1\nelse if x == 2\n    send 2\nelse if x == 3\n"
+                                                              "    send 3\nelse if x == 4\n    send 4\nelse\n    send 5\n", lines / 4));
+    std::string globals;
+    for (size_t i = 0; i < 1000; ++i) {
+        globals += "global" + std::to_string(i) + " = " + std::to_string(i) + "\n";
+    }
+    std::string calls = script("calls", globals + "func add a, b\n    variable c = a + b + global999\n" + repeat("add 1, 2\n", lines));
+    std::string elements;
+    for (size_t i = 0; i < 1024; ++i) {
+        elements += (i == 0 ? "" : ", ") + std::to_string(i);
+    }
+    std::string arrays = script("arrays", "a = [" + elements + "]\nt = 0\nfor i in 0.." + std::to_string(lines) +
+                                          "\n    t = t + sum(a * 2 + a) + dot(a, a)\n");
+    std::string report = script("report", "report = \"\"\nfor i in 0.." + std::to_string(lines) +
+                                          "\n    report = report + \"row \" + i + \" of the generated report\"\nsend len(report)\n");
+    std::string lookups = script("lookups", "func price tier\n    variable i = 0\n    variable cost = 0\n    for i in 0..50\n"
+                                            "        cost = tier * i + cost\n    result = cost\nfor n in 0.." + std::to_string(lines / 4) +
+                                            "\n    for tier in 0..4\n        price tier\n");
+    std::string callLoop = "for i in 0.." + std::to_string(lines) + "\n    mix i, 7\n";
+    std::string scriptCalls = script("script_calls", "func mix a, b\n    result = a * 31 + b\n" + callLoop);
+    std::string nativeCalls = script("native_calls", callLoop);
+    auto defineMix = [](Interpreter& interpreter) {
+        Interpreter::GlobalSlot result = interpreter.globalSlot("result");
+        interpreter.defineNative("mix", { NativeType::Integer, NativeType::Integer }, [result](NativeCall& call) {
+            call.interpreter().setGlobal(result, Value::integer(call.integer(0) * 31 + call.integer(1)));
+        });
+    };
+    std::string helpers;
+    for (size_t i = 0; i < 200; ++i) {
+        helpers += "func helper" + std::to_string(i) + " x\n    out = x * " + std::to_string(i) + " + 1\n";
+    }
+    std::string prelude = script("prelude", helpers + "table = 0\nfor i in 0..20000\n    table = i + table\n");
+    std::string job = "helper7 table\nsend out\n";
+    std::string coldJob = script("cold_job", "run " + prelude + "\n" + job);
+    std::string warmJob = script("warm_job", job);
+    std::string image = (work / "prelude.img").generic_string();
+    {
+        StringSink output;
+        Interpreter interpreter;
+        interpreter.setCacheEnabled(false);
+        interpreter.setOutputSink(output);
+        interpreter.handleRunCommand(prelude);
+        interpreter.saveSnapshot(image);
+    }
+    std::string largeFile = script("large", generatedProgram(200000));
+    std::string example = (std::filesystem::path(SYNZE_SOURCE_DIR) / "example.synze").generic_string();
+    std::string exampleInput = readFile(options.fixtures / "example.stdin");
+
+    std::vector<Result> results;
+    auto add = [&](const std::string& name, size_t opsPerCall, const std::function<void()>& body) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) return;
+        results.push_back(measure(options, name, opsPerCall, body));
+        std::cerr << name << ": " << results.back().nsPerOp << " ns/op" << std::endl;
+    };
+
+    add("tokenize", 1, [&] { tokenize(lexSource); });
+    if (!results.empty() && results.back().name == "tokenize") {
+        results.back().mbPerSecond = static_cast<double>(lexSource.size()) / results.back().nsPerOp * 1e3;
+    }
+    add("send_arithmetic", lines, [&] { runScript(options, arithmetic); });
+    add("string_interpolation", lines, [&] { runScript(options, interpolation); });
+    add("if_else_chain", lines / 4, [&] { runScript(options, chains); });
+    add("function_call_many_globals", lines, [&] { runScript(options, calls); });
+    add("array_math", lines, [&] { runScript(options, arrays); });
+    add("string_building", lines, [&] { runScript(options, report); });
+    add("script_function_call", lines, [&] { runScript(options, scriptCalls); });
+    add("native_function_call", lines, [&] { runScript(options, nativeCalls, "", false, defineMix); });
+    add("pure_function_lookup", lines, [&] { runScript(options, lookups); });
+    add("prelude_run", 1, [&] { runScript(options, coldJob); });
+    add("prelude_snapshot", 1, [&] {
+        runScript(options, warmJob, "", false, [&image](Interpreter& interpreter) { interpreter.loadSnapshot(image); });
+    });
+    add("run_large_file", 1, [&] { runScript(options, largeFile); });
+    add("run_large_file_cached", 1, [&] { runScript(options, largeFile, "", true); });
+    add("example_script", 1, [&] { runScript(options, example, exampleInput); });
+
+    std::error_code error;
+    std::filesystem::remove_all(work, error);
+
+    printJson(options, results);
+    return 0;
+}
@@ -1,8 +1,307 @@
+#include "BatchRunner.hpp"
 #include "Interpreter.hpp"
+#include "Lexer.hpp"
+#include "Profiler.hpp"
+#include "ScriptError.hpp"
+#include "Simd.hpp"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const char usage[] =
+    "Usage: Synze [--engine=tree|vm] [--max-depth=N] [--flush=line|block|exit]\n"
+    "             [--parse-budget=BYTES] [--no-cache] [--cache-dir=DIR]\n"
+    "             [--simd=scalar|sse2|avx2] [--lex-bench=file.synze] [--profile[=PREFIX]]\n"
+    "             [--opt=0|1|2] [--dump-program] [--time-startup] [--memo=N] [--memo-stats]\n"
+    "             [--snapshot=FILE] [--save-snapshot=FILE]\n"
+    "       Synze [options] script.synze|- [args...]\n"
+    "       Synze [options] --jobs N script.synze...\n"
+    "       Synze [options] [--jobs N] --manifest=scripts.txt";
+
+// Taken during static initialization, as close to process start as portable
+// code gets, for --time-startup.
+static const auto processStart = std::chrono::steady_clock::now();
+
+// Writes PREFIX.txt, the sorted report, and PREFIX.folded, collapsed stacks
+// for flamegraph tools.
+static void writeProfile(Profiler& profiler, const std::string& prefix) {
+    profiler.finish();
+    std::ofstream report(prefix + ".txt");
+    profiler.writeReport(report);
+    std::ofstream collapsed(prefix + ".folded");
+    profiler.writeCollapsed(collapsed);
+    if (!report || !collapsed) {
+        std::cerr << "Unable to write profile: " << prefix << std::endl;
+        return;
+    }
+    std::cerr << "Profile written to " << prefix << ".txt and " << prefix << ".folded" << std::endl;
+}
+
+static bool isCount(const std::string& text) {
+    return !text.empty() && text.find_first_not_of("0123456789") == std::string::npos;
+}
+
+// Lexes a file repeatedly for about half a second and reports throughput.
+static int runLexBenchmark(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Unable to open file: " << path << std::endl;
+        return 1;
+    }
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    std::string source = buffer.str();
+
+    size_t tokens = 0;
+    size_t runs = 0;
+    std::chrono::duration<double> elapsed(0);
+    try {
+        auto start = std::chrono::steady_clock::now();
+        do {
+            tokens = tokenize(source).tokens.size();
+            ++runs;
+            elapsed = std::chrono::steady_clock::now() - start;
+        } while (elapsed.count() < 0.5);
+    } catch (const ScriptError& e) {
+        std::cerr << "Error in line " << e.line() << " of " << path << ": " << e.what() << std::endl;
+        return 1;
+    }
+
+    double megabytes = static_cast<double>(source.size()) * runs / 1e6;
+    std::cout << "Lexed " << source.size() << " bytes into " << tokens << " tokens " << runs << " times ("
+              << simdLevelName(getSimdLevel()) << "): " << megabytes / elapsed.count() << " MB/s" << std::endl;
+    return 0;
+}
+
+static void reportMemoStats(const Interpreter& interpreter) {
+    const Interpreter::MemoStats& stats = interpreter.getMemoStats();
+    std::cerr << "Memo: " << stats.hits << " hits, " << stats.misses << " misses" << std::endl;
+}
+
+// Saves the state a script or REPL session left behind for --save-snapshot.
+// A failed run is not saved, so a broken prelude never becomes the start state.
+static int saveSnapshot(const Interpreter& interpreter, const std::string& path, int status) {
+    if (status != 0) {
+        std::cerr << "Snapshot not saved: the script reported errors." << std::endl;
+        return status;
+    }
+    try {
+        interpreter.saveSnapshot(path);
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+static void reportStartup(const Interpreter& interpreter) {
+    auto first = interpreter.getFirstStatementTime();
+    if (first.time_since_epoch().count() == 0) {
+        std::cerr << "Startup: no statement ran" << std::endl;
+        return;
+    }
+    double milliseconds = std::chrono::duration<double, std::milli>(first - processStart).count();
+    std::cerr << "Startup: " << milliseconds << " ms from process start to first statement" << std::endl;
+}
+
+// Runs a script without the REPL: no banner or timing lines, and an exit
+// status of 1 if the script could not be loaded or reported errors. A path of
+// "-" reads the script from standard input.
+static int runScript(Interpreter& interpreter, const std::string& path) {
+    interpreter.setRunSummaries(false);
+    try {
+        if (path == "-") {
+            std::string source;
+            std::string line;
+            while (interpreter.readInputLine(line)) {
+                source += line;
+                source += '\n';
+            }
+            interpreter.executeSource(source, "<stdin>");
+        } else {
+            interpreter.handleRunCommand(path);
+        }
+    } catch (const std::exception& e) {
+        interpreter.flushOutput();
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    interpreter.flushOutput();
+    return interpreter.getErrorCount() > 0 ? 1 : 0;
+}
+
+// Runs every script in its own interpreter on `jobs` threads. Each script's
+// output is printed in list order, followed by a timing summary on stderr.
+static int runBatch(Interpreter& settings, unsigned jobs, const std::vector<std::string>& scripts,
+                    const std::string& snapshotPath) {
+    BatchRunner runner(jobs);
+    runner.setConfigure([&settings, &snapshotPath](Interpreter& interpreter) {
+        interpreter.setEngine(settings.getEngine());
+        interpreter.setMaxCallDepth(settings.getMaxCallDepth());
+        interpreter.setParseBudget(settings.getParseBudget());
+        interpreter.setCacheEnabled(settings.isCacheEnabled());
+        interpreter.setCacheDirectory(settings.getCacheDirectory());
+        interpreter.setOptimizationLevel(settings.getOptimizationLevel());
+        interpreter.setMemoCapacity(settings.getMemoCapacity());
+        if (!snapshotPath.empty()) interpreter.loadSnapshot(snapshotPath);
+    });
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<BatchResult> results = runner.run(scripts, [](const BatchResult& result) {
+        std::cout << result.output << std::flush;
+        std::cerr << result.errors << std::flush;
+    });
+    double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    BatchRunner::printSummary(std::cerr, results, jobs, milliseconds);
+    for (const BatchResult& result : results) {
+        if (result.status != BatchResult::Status::Ok) return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[]) {
+    // Lets std::cin read in blocks, which the interpreter's input reader relies on.
+    std::ios::sync_with_stdio(false);
 
-int main() {
     Interpreter interpreter;
+    std::string lexBenchmarkPath;
+    std::string manifestPath;
+    std::string profilePrefix;
+    std::string snapshotPath;
+    std::string saveSnapshotPath;
+    std::vector<std::string> scripts;
+    std::vector<std::string> scriptArguments;
+    unsigned jobs = 0;
+    bool flushSet = false;
+    bool timeStartup = false;
+    bool memoStats = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=tree") {
+            interpreter.setEngine(Interpreter::Engine::Tree);
+        } else if (arg == "--engine=vm") {
+            interpreter.setEngine(Interpreter::Engine::VM);
+        } else if (arg.rfind("--max-depth=", 0) == 0 && arg.size() > 12 &&
+                   arg.find_first_not_of("0123456789", 12) == std::string::npos) {
+            interpreter.setMaxCallDepth(std::stoul(arg.substr(12)));
+        } else if (arg.rfind("--parse-budget=", 0) == 0 && arg.size() > 15 &&
+                   arg.find_first_not_of("0123456789", 15) == std::string::npos) {
+            interpreter.setParseBudget(std::stoull(arg.substr(15)));
+        } else if (arg == "--flush=line") {
+            interpreter.getOutputSink().setFlushPolicy(OutputSink::FlushPolicy::Line);
+            flushSet = true;
+        } else if (arg == "--flush=block") {
+            interpreter.getOutputSink().setFlushPolicy(OutputSink::FlushPolicy::Block);
+            flushSet = true;
+        } else if (arg == "--flush=exit") {
+            interpreter.getOutputSink().setFlushPolicy(OutputSink::FlushPolicy::Exit);
+            flushSet = true;
+        } else if (arg == "--opt=0" || arg == "--opt=1" || arg == "--opt=2") {
+            interpreter.setOptimizationLevel(arg[6] - '0');
+        } else if (arg == "--dump-program") {
+            interpreter.setDumpPrograms(true);
+        } else if (arg == "--no-cache") {
+            interpreter.setCacheEnabled(false);
+        } else if (arg.rfind("--cache-dir=", 0) == 0 && arg.size() > 12) {
+            interpreter.setCacheDirectory(arg.substr(12));
+        } else if (arg == "--simd=scalar") {
+            setSimdLevel(SimdLevel::Scalar);
+        } else if (arg == "--simd=sse2") {
+            setSimdLevel(SimdLevel::SSE2);
+        } else if (arg == "--simd=avx2") {
+            setSimdLevel(SimdLevel::AVX2);
+        } else if (arg.rfind("--lex-bench=", 0) == 0 && arg.size() > 12) {
+            lexBenchmarkPath = arg.substr(12);
+        } else if (arg == "--profile") {
+            profilePrefix = "synze-profile";
+        } else if (arg.rfind("--profile=", 0) == 0 && arg.size() > 10) {
+            profilePrefix = arg.substr(10);
+        } else if (arg == "--jobs" && i + 1 < argc && isCount(argv[i + 1])) {
+            jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg.rfind("--jobs=", 0) == 0 && isCount(arg.substr(7))) {
+            jobs = static_cast<unsigned>(std::stoul(arg.substr(7)));
+        } else if (arg == "--manifest" && i + 1 < argc) {
+            manifestPath = argv[++i];
+        } else if (arg.rfind("--manifest=", 0) == 0 && arg.size() > 11) {
+            manifestPath = arg.substr(11);
+        } else if (arg == "--time-startup") {
+            timeStartup = true;
+        } else if (arg.rfind("--memo=", 0) == 0 && isCount(arg.substr(7))) {
+            interpreter.setMemoCapacity(std::stoul(arg.substr(7)));
+        } else if (arg == "--memo-stats") {
+            memoStats = true;
+        } else if (arg.rfind("--snapshot=", 0) == 0 && arg.size() > 11) {
+            snapshotPath = arg.substr(11);
+        } else if (arg.rfind("--save-snapshot=", 0) == 0 && arg.size() > 16) {
+            saveSnapshotPath = arg.substr(16);
+        } else if (arg.rfind("--", 0) != 0) {
+            scripts.push_back(arg);
+            // Without a batch option, the first script runs on its own and
+            // everything after it belongs to the script.
+            if (jobs == 0 && manifestPath.empty()) {
+                scriptArguments.assign(argv + i + 1, argv + argc);
+                break;
+            }
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n" << usage << std::endl;
+            return 1;
+        }
+    }
+
+    if (!lexBenchmarkPath.empty()) {
+        return runLexBenchmark(lexBenchmarkPath);
+    }
+
+    // Loaded here even in batch mode, where each job loads it again, so a bad
+    // file is reported once.
+    if (!snapshotPath.empty()) {
+        try {
+            interpreter.loadSnapshot(snapshotPath);
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    if (jobs > 0 || !manifestPath.empty()) {
+        if (!manifestPath.empty()) {
+            try {
+                std::vector<std::string> listed = BatchRunner::readManifest(manifestPath);
+                scripts.insert(scripts.end(), listed.begin(), listed.end());
+            } catch (const std::exception& e) {
+                std::cerr << "Error: " << e.what() << std::endl;
+                return 1;
+            }
+        }
+        if (!profilePrefix.empty()) std::cerr << "--profile is ignored in batch mode." << std::endl;
+        if (memoStats) std::cerr << "--memo-stats is ignored in batch mode." << std::endl;
+        if (!saveSnapshotPath.empty()) std::cerr << "--save-snapshot is ignored in batch mode." << std::endl;
+        if (jobs == 0) jobs = std::max(1u, std::thread::hardware_concurrency());
+        return runBatch(interpreter, jobs, scripts, snapshotPath);
+    }
+
+    Profiler profiler;
+    if (!profilePrefix.empty()) interpreter.setProfiler(&profiler);
+
+    if (!scripts.empty()) {
+        // Output is usually piped here, so it is written in blocks rather than per line.
+        if (!flushSet) interpreter.getOutputSink().setFlushPolicy(OutputSink::FlushPolicy::Block);
+        interpreter.setScriptArguments(scriptArguments);
+        int status = runScript(interpreter, scripts.front());
+        if (!saveSnapshotPath.empty()) status = saveSnapshot(interpreter, saveSnapshotPath, status);
+        if (!profilePrefix.empty()) writeProfile(profiler, profilePrefix);
+        if (timeStartup) reportStartup(interpreter);
+        if (memoStats) reportMemoStats(interpreter);
+        return status;
+    }
+
     std::cout << "\n#######  ##    ##  ###    ##  #######  ####### \n";
     std::cout << "##        ##  ##   ####   ##     ###   ##      \n";
     std::cout << "#######    ####    ## ##  ##    ###    #####   \n";
@@ -11,14 +310,31 @@ int main() {
     std::cout << "The Synze Interpreter is active.\n\nType 'exit' to quit.\nType 'help' for more help.\n\n";
 
     std::string line;
-    while (true) {
+    while (!interpreter.isExitRequested()) {
         try {
-            std::cout << ">> ";
-            std::getline(std::cin, line);
+            interpreter.flushOutput();
+            std::cout << ">> " << std::flush;
+            if (!interpreter.readInputLine(line)) {
+                // End of input: run a block that was still being entered, then quit.
+                std::cout << '\n';
+                interpreter.execute("");
+                break;
+            }
             interpreter.execute(line);
         } catch (const std::exception& e) {
+            interpreter.flushOutput();
             std::cerr << "Error: " << e.what() << std::endl;
         }
     }
+
+    interpreter.flushOutput();
+    if (!saveSnapshotPath.empty()) saveSnapshot(interpreter, saveSnapshotPath, 0);
+    if (!profilePrefix.empty()) writeProfile(profiler, profilePrefix);
+    if (timeStartup) reportStartup(interpreter);
+    if (memoStats) reportMemoStats(interpreter);
+    std::cout << "\x1B[2JExiting the interpreter." << std::endl;
+    std::this_thread::sleep_for(std::chrono::milliseconds(750));
+    std::cout << "\x1B[2JGoodbye!" << std::endl;
+    std::this_thread::sleep_for(std::chrono::milliseconds(750));
     return 0;
-}
\ No newline at end of file
+}
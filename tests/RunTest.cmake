@@ -0,0 +1,17 @@
+# Runs SYNZE with ARGS (separated by '|') and compares its standard output
+# with the file EXPECTED and, if ERRORS is set, its standard error with the
+# file ERRORS.
+string(REPLACE "|" ";" args "${ARGS}")
+execute_process(COMMAND ${SYNZE} ${args} OUTPUT_VARIABLE output ERROR_VARIABLE errors)
+
+function(compare what actual file)
+    file(READ ${file} expected)
+    if(NOT actual STREQUAL expected)
+        message(FATAL_ERROR "Unexpected ${what}:\n${actual}\nExpected (${file}):\n${expected}")
+    endif()
+endfunction()
+
+compare("output" "${output}" ${EXPECTED})
+if(ERRORS)
+    compare("errors" "${errors}" ${ERRORS})
+endif()
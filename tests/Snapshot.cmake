@@ -0,0 +1,33 @@
+# Saves a snapshot after snapshot_prelude.synze, runs snapshot_job.synze from
+# it and compares the output with snapshot.out, then checks that damaged
+# images and files that are not snapshots are refused. ARGS are passed to
+# every run; images go to WORK.
+string(REPLACE "|" ";" args "${ARGS}")
+file(MAKE_DIRECTORY ${WORK})
+set(image ${WORK}/prelude.img)
+
+execute_process(COMMAND ${SYNZE} ${args} --save-snapshot=${image} snapshot_prelude.synze
+                OUTPUT_QUIET RESULT_VARIABLE status)
+if(NOT status EQUAL 0)
+    message(FATAL_ERROR "Saving the snapshot failed with status ${status}.")
+endif()
+
+execute_process(COMMAND ${SYNZE} ${args} --snapshot=${image} snapshot_job.synze OUTPUT_VARIABLE output)
+file(READ snapshot.out expected)
+if(NOT output STREQUAL expected)
+    message(FATAL_ERROR "Unexpected output:\n${output}\nExpected:\n${expected}")
+endif()
+
+function(expect_refused file message)
+    execute_process(COMMAND ${SYNZE} ${args} --snapshot=${file} snapshot_job.synze
+                    OUTPUT_VARIABLE output ERROR_VARIABLE errors RESULT_VARIABLE status)
+    if(status EQUAL 0 OR NOT output STREQUAL "" OR NOT errors MATCHES "${message}")
+        message(FATAL_ERROR "${file} was not refused with '${message}':\n${output}${errors}")
+    endif()
+endfunction()
+
+configure_file(${image} ${WORK}/extended.img COPYONLY)
+file(APPEND ${WORK}/extended.img "trailing bytes")
+expect_refused(${WORK}/extended.img "Corrupt snapshot")
+expect_refused(snapshot_job.synze "Not a snapshot")
+expect_refused(${WORK}/missing.img "Unable to open snapshot")
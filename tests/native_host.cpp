@@ -0,0 +1,36 @@
+// A minimal embedding host for the tests: registers a few natives and runs
+// the script given on the command line.
+//
+//   native_host [--engine=tree|vm] [--no-cache] script.synze
+
+#include "Interpreter.hpp"
+#include <iostream>
+#include <string>
+
+int main(int argc, char* argv[]) {
+    Interpreter interpreter;
+    interpreter.setRunSummaries(false);
+    std::string script;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--engine=tree") {
+            interpreter.setEngine(Interpreter::Engine::Tree);
+        } else if (arg == "--engine=vm") {
+            interpreter.setEngine(Interpreter::Engine::VM);
+        } else if (arg == "--no-cache") {
+            interpreter.setCacheEnabled(false);
+        } else {
+            script = arg;
+        }
+    }
+
+    Interpreter::GlobalSlot length = interpreter.globalSlot("length");
+    interpreter.defineNative("measure", { NativeType::String }, [length](NativeCall& call) {
+        call.interpreter().setGlobal(length, Value::integer(static_cast<int64_t>(call.string(0).size())));
+    });
+    interpreter.setGlobal("greeting", Value::string("hello from the host"));
+
+    interpreter.handleRunCommand(script);
+    interpreter.flushOutput();
+    return interpreter.getErrorCount() > 0 ? 1 : 0;
+}